@@ -0,0 +1,236 @@
+#ifndef _AGGREGATIONMAP_HPP_
+#define _AGGREGATIONMAP_HPP_
+#define DEFAULT_PARTITIONS 64
+#define DEFAULT_FLUSH_THRESHOLD 4096
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "HashMap.hpp"
+
+/***
+ * a concurrent group-by map: values of the same key are folded together
+ * with CombineOp, which must be associative and commutative. the shared
+ * table is split into locked partitions, and each thread can buffer its
+ * updates in a LocalBuffer that is flushed in batches, one lock per
+ * partition.
+ */
+template <typename KeyT, typename ValueT,
+    typename CombineOp = std::plus<ValueT>>
+class AggregationMap
+{
+  struct Partition
+  {
+    std::mutex lock;
+    HashMap<KeyT, ValueT> table;
+  };
+
+  struct Pending
+  {
+    ValueT value;
+    size_t hash;
+  };
+
+  std::vector<std::unique_ptr<Partition>> _partitions;
+  unsigned int _shift;
+  CombineOp _op;
+
+ public:
+  /***
+   * a per thread pre-aggregation table, not thread safe itself. it flushes
+   * into the shared map when it holds flush_threshold keys, on flush() and
+   * when destroyed
+   */
+  class LocalBuffer
+  {
+    AggregationMap &_owner;
+    HashMap<KeyT, Pending> _table;
+    size_t _flush_threshold;
+
+   public:
+    explicit LocalBuffer(AggregationMap &owner,
+                         size_t flush_threshold = DEFAULT_FLUSH_THRESHOLD) :
+        _owner (owner), _flush_threshold (flush_threshold) {}
+
+    LocalBuffer(const LocalBuffer &) = delete;
+    LocalBuffer &operator=(const LocalBuffer &) = delete;
+
+    ~LocalBuffer()
+    {
+      flush ();
+    }
+
+    void add(const KeyT &key, const ValueT &delta)
+    {
+      combine (key, delta);
+    }
+
+    void combine(const KeyT &key, const ValueT &value)
+    {
+      size_t hash_value = std::hash<KeyT> {} (key);
+      Pending *pending = HashedAccess::find (_table, key, hash_value);
+      if (pending != nullptr)
+      {
+        pending->value = _owner._op (pending->value, value);
+        return;
+      }
+      HashedAccess::insert (_table, key, Pending {value, hash_value},
+                            hash_value);
+      if (_table.size () >= _flush_threshold)
+      {
+        flush ();
+      }
+    }
+
+    /***
+     * radix partitions the buffered keys and folds each partition into
+     * the shared table under a single lock
+     */
+    void flush()
+    {
+      if (_table.empty ())
+      {
+        return;
+      }
+      std::vector<std::vector<const std::pair<KeyT, Pending> *>> parts (
+          _owner._partitions.size ());
+      for (const auto &cur : _table)
+      {
+        parts[_owner.partition_of (cur.second.hash)].push_back (&cur);
+      }
+      for (size_t i = 0; i < parts.size (); i++)
+      {
+        if (parts[i].empty ())
+        {
+          continue;
+        }
+        Partition &partition = *_owner._partitions[i];
+        std::lock_guard<std::mutex> guard (partition.lock);
+        for (const auto *cur : parts[i])
+        {
+          _owner.fold (partition.table, cur->first, cur->second.value,
+                       cur->second.hash);
+        }
+      }
+      _table.clear ();
+    }
+
+    size_t size() const
+    {
+      return _table.size ();
+    }
+  };
+
+  /***
+   * @param partitions number of locked partitions, rounded up to a power
+   * of 2
+   * @param op the fold of two values of the same key
+   */
+  explicit AggregationMap(size_t partitions = DEFAULT_PARTITIONS,
+                          CombineOp op = CombineOp ()) : _op (op)
+  {
+    _shift = top_bits_shift (partitions);
+    size_t count = top_bits_count (_shift);
+    for (size_t i = 0; i < count; i++)
+    {
+      _partitions.emplace_back (new Partition ());
+    }
+  }
+
+  /***
+   * adds delta to the value of key straight in the shared table
+   */
+  void add(const KeyT &key, const ValueT &delta)
+  {
+    combine (key, delta);
+  }
+
+  /***
+   * folds value into the value of key straight in the shared table
+   */
+  void combine(const KeyT &key, const ValueT &value)
+  {
+    size_t hash_value = std::hash<KeyT> {} (key);
+    Partition &partition = *_partitions[partition_of (hash_value)];
+    std::lock_guard<std::mutex> guard (partition.lock);
+    fold (partition.table, key, value, hash_value);
+  }
+
+  /***
+   * folds every aggregated value into target, keys missing there are
+   * inserted as is. buffers that were not flushed yet are not included
+   * @param target
+   */
+  void merge_into(HashMap<KeyT, ValueT> &target)
+  {
+    for (auto &partition : _partitions)
+    {
+      std::lock_guard<std::mutex> guard (partition->lock);
+      for (const auto &cur : partition->table)
+      {
+        fold (target, cur.first, cur.second, std::hash<KeyT> {} (cur.first));
+      }
+    }
+  }
+
+  /***
+   * @return a plain HashMap with the aggregated value of every key
+   */
+  HashMap<KeyT, ValueT> merge()
+  {
+    HashMap<KeyT, ValueT> result;
+    merge_into (result);
+    return result;
+  }
+
+  /***
+   * @return number of distinct keys in the shared table
+   */
+  size_t size() const
+  {
+    size_t total = 0;
+    for (const auto &partition : _partitions)
+    {
+      std::lock_guard<std::mutex> guard (partition->lock);
+      total += partition->table.size ();
+    }
+    return total;
+  }
+
+  size_t partition_count() const
+  {
+    return _partitions.size ();
+  }
+
+  void clear()
+  {
+    for (auto &partition : _partitions)
+    {
+      std::lock_guard<std::mutex> guard (partition->lock);
+      partition->table.clear ();
+    }
+  }
+
+ private:
+  size_t partition_of(size_t hash_value) const
+  {
+    return top_bits_idx (hash_value, _shift);
+  }
+
+  void fold(HashMap<KeyT, ValueT> &table, const KeyT &key,
+            const ValueT &value, size_t hash_value)
+  {
+    ValueT *cur = HashedAccess::find (table, key, hash_value);
+    if (cur != nullptr)
+    {
+      *cur = _op (*cur, value);
+    }
+    else
+    {
+      HashedAccess::insert (table, key, value, hash_value);
+    }
+  }
+};
+
+#endif //_AGGREGATIONMAP_HPP_
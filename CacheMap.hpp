@@ -0,0 +1,682 @@
+#ifndef _CACHEMAP_HPP_
+#define _CACHEMAP_HPP_
+#define SMALL_QUEUE_RATIO 0.1
+#define MAX_FREQUENCY 3
+#define DEFAULT_SHARDS 16
+#define INVALID_CAPACITY_ERROR "cache capacity must be positive"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "HashMap.hpp"
+
+enum class EvictionPolicy
+{
+  LRU,
+  CLOCK,
+  S3FIFO
+};
+
+enum class CapacityUnit
+{
+  ENTRIES,
+  BYTES
+};
+
+struct CacheStats
+{
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t evictions = 0;
+};
+
+/***
+ * a bounded cache on top of HashMap. the HashMap indexes the key to a node
+ * in a slot array, the nodes hold the values and the eviction policy state.
+ * every get/put hashes the key once.
+ */
+template <typename KeyT, typename ValueT>
+class CacheMap
+{
+ public:
+  typedef std::function<size_t (const KeyT &, const ValueT &)> Weigher;
+
+ private:
+  static constexpr size_t NIL = SIZE_MAX;
+  enum Queue : unsigned char
+  {
+    MAIN,
+    SMALL
+  };
+
+  struct Node
+  {
+    KeyT key;
+    ValueT value;
+    size_t hash = 0;
+    size_t weight = 0;
+    size_t prev = NIL;
+    size_t next = NIL;
+    unsigned char freq = 0;
+    Queue queue = MAIN;
+    bool used = false;
+  };
+
+  struct List
+  {
+    size_t head = NIL;
+    size_t tail = NIL;
+    size_t weight = 0;
+  };
+
+  struct Ghost
+  {
+    KeyT key;
+    size_t hash;
+    size_t stamp;
+  };
+
+  HashMap<KeyT, size_t> _index;
+  std::vector<Node> _nodes;
+  std::vector<size_t> _free;
+  // LRU order, or the S3-FIFO main queue
+  List _main;
+  // the S3-FIFO probation queue
+  List _small;
+  // S3-FIFO keys recently evicted from the small queue
+  HashMap<KeyT, size_t> _ghost;
+  std::deque<Ghost> _ghost_fifo;
+  size_t _ghost_stamp = 0;
+  size_t _hand = 0;
+  size_t _capacity;
+  size_t _weight = 0;
+  EvictionPolicy _policy;
+  CapacityUnit _unit;
+  Weigher _weigher;
+  CacheStats _stats;
+
+ public:
+  /***
+   * @param capacity maximal number of entries or bytes held
+   * @param policy which entry to evict when full
+   * @param unit whether capacity counts entries or bytes
+   * @param weigher bytes of an entry, sizeof key and value if not given
+   */
+  CacheMap(size_t capacity, EvictionPolicy policy = EvictionPolicy::LRU,
+           CapacityUnit unit = CapacityUnit::ENTRIES,
+           Weigher weigher = nullptr) :
+      _capacity (capacity), _policy (policy), _unit (unit),
+      _weigher (weigher)
+  {
+    if (capacity == 0)
+    {
+      throw std::invalid_argument (INVALID_CAPACITY_ERROR);
+    }
+  }
+
+  /***
+   * gets a value from the cache and marks it as used
+   * @param key
+   * @param value filled with the cached value on a hit
+   * @return true on a hit
+   */
+  bool get(const KeyT &key, ValueT &value)
+  {
+    return get_hashed (key, std::hash<KeyT> {} (key), value);
+  }
+
+  /***
+   * inserts or replaces a value, evicting entries until it fits
+   * @param key
+   * @param value
+   * @return false if the entry alone is bigger than the capacity
+   */
+  bool put(const KeyT &key, ValueT value)
+  {
+    return put_hashed (key, std::hash<KeyT> {} (key), std::move (value));
+  }
+
+  /***
+   * removes a key from the cache, not counted as an eviction
+   * @param key
+   * @return true if the key was inside
+   */
+  bool erase(const KeyT &key)
+  {
+    return erase_hashed (key, std::hash<KeyT> {} (key));
+  }
+
+  /***
+   * checks if a key is cached without touching the policy or the stats
+   * @param key
+   * @return true if inside
+   */
+  bool contains_key(const KeyT &key) const
+  {
+    return HashedAccess::find (_index, key, std::hash<KeyT> {} (key))
+           != nullptr;
+  }
+
+  /***
+   * drops every entry, the stats are kept
+   */
+  void clear()
+  {
+    _index.clear ();
+    _ghost.clear ();
+    _ghost_fifo.clear ();
+    _nodes.clear ();
+    _free.clear ();
+    _main = List ();
+    _small = List ();
+    _hand = 0;
+    _weight = 0;
+  }
+
+  size_t size() const
+  {
+    return _index.size ();
+  }
+
+  /***
+   * total weight of the cached entries, equals size() when counting entries
+   */
+  size_t weight() const
+  {
+    return _weight;
+  }
+
+  size_t capacity() const
+  {
+    return _capacity;
+  }
+
+  bool empty() const
+  {
+    return _index.empty ();
+  }
+
+  EvictionPolicy policy() const
+  {
+    return _policy;
+  }
+
+  const CacheStats &stats() const
+  {
+    return _stats;
+  }
+
+  void reset_stats()
+  {
+    _stats = CacheStats ();
+  }
+
+ private:
+  // ShardedCacheMap hashes a key once to pick the shard and to look it up
+  template <typename K, typename V> friend class ShardedCacheMap;
+
+  /***
+   * get, put and erase with the hash of the key already computed. private
+   * so only a caller that computed it with std::hash<KeyT> passes it
+   */
+  bool get_hashed(const KeyT &key, size_t hash_value, ValueT &value)
+  {
+    size_t *slot = HashedAccess::find (_index, key, hash_value);
+    if (slot == nullptr)
+    {
+      _stats.misses++;
+      return false;
+    }
+    _stats.hits++;
+    touch (*slot);
+    value = _nodes[*slot].value;
+    return true;
+  }
+
+  bool put_hashed(const KeyT &key, size_t hash_value, ValueT value)
+  {
+    size_t weight = weigh (key, value);
+    if (weight > _capacity)
+    {
+      erase_hashed (key, hash_value);
+      return false;
+    }
+    size_t *slot = HashedAccess::find (_index, key, hash_value);
+    if (slot != nullptr)
+    {
+      size_t idx = *slot;
+      Node &node = _nodes[idx];
+      _weight = _weight - node.weight + weight;
+      list_of (node).weight += weight - node.weight;
+      node.weight = weight;
+      node.value = std::move (value);
+      touch (idx);
+      while (_weight > _capacity)
+      {
+        evict (idx);
+      }
+      return true;
+    }
+    Queue queue = MAIN;
+    if (_policy == EvictionPolicy::S3FIFO)
+    {
+      queue = HashedAccess::erase (_ghost, key, hash_value) ? MAIN : SMALL;
+    }
+    while (_weight + weight > _capacity)
+    {
+      evict (NIL);
+    }
+    size_t idx = allocate_node ();
+    Node &node = _nodes[idx];
+    node.key = key;
+    node.value = std::move (value);
+    node.hash = hash_value;
+    node.weight = weight;
+    node.freq = 0;
+    node.queue = queue;
+    node.used = true;
+    if (_policy != EvictionPolicy::CLOCK)
+    {
+      push_front (list_of (node), idx);
+    }
+    _weight += weight;
+    HashedAccess::insert (_index, key, idx, hash_value);
+    return true;
+  }
+
+  bool erase_hashed(const KeyT &key, size_t hash_value)
+  {
+    size_t *slot = HashedAccess::find (_index, key, hash_value);
+    if (slot == nullptr)
+    {
+      return false;
+    }
+    release (*slot, hash_value);
+    return true;
+  }
+
+  size_t weigh(const KeyT &key, const ValueT &value) const
+  {
+    if (_unit == CapacityUnit::ENTRIES)
+    {
+      return 1;
+    }
+    if (_weigher)
+    {
+      return _weigher (key, value);
+    }
+    return sizeof (KeyT) + sizeof (ValueT);
+  }
+
+  List &list_of(const Node &node)
+  {
+    return node.queue == SMALL ? _small : _main;
+  }
+
+  /***
+   * records an access to a cached node according to the policy
+   */
+  void touch(size_t idx)
+  {
+    Node &node = _nodes[idx];
+    switch (_policy)
+    {
+      case EvictionPolicy::LRU:
+        unlink (_main, idx);
+        push_front (_main, idx);
+        break;
+      case EvictionPolicy::CLOCK:
+        node.freq = 1;
+        break;
+      case EvictionPolicy::S3FIFO:
+        if (node.freq < MAX_FREQUENCY)
+        {
+          node.freq++;
+        }
+        break;
+    }
+  }
+
+  /***
+   * evicts one entry
+   * @param keep a node that must not be chosen, NIL if none
+   */
+  void evict(size_t keep)
+  {
+    size_t victim = NIL;
+    switch (_policy)
+    {
+      case EvictionPolicy::LRU:
+        victim = _main.tail == keep ? _nodes[keep].prev : _main.tail;
+        break;
+      case EvictionPolicy::CLOCK:
+        victim = clock_victim (keep);
+        break;
+      case EvictionPolicy::S3FIFO:
+        victim = s3fifo_victim (keep);
+        break;
+    }
+    if (victim == NIL)
+    {
+      return;
+    }
+    _stats.evictions++;
+    Node &node = _nodes[victim];
+    if (_policy == EvictionPolicy::S3FIFO && node.queue == SMALL)
+    {
+      remember_ghost (node.key, node.hash);
+    }
+    release (victim, node.hash);
+  }
+
+  size_t clock_victim(size_t keep)
+  {
+    // two sweeps clear every reference bit, so a victim is always found
+    for (size_t steps = 0; steps < 2 * _nodes.size () + 1; steps++)
+    {
+      if (_hand >= _nodes.size ())
+      {
+        _hand = 0;
+      }
+      size_t idx = _hand++;
+      Node &node = _nodes[idx];
+      if (!node.used || idx == keep)
+      {
+        continue;
+      }
+      if (node.freq)
+      {
+        node.freq = 0;
+        continue;
+      }
+      return idx;
+    }
+    return NIL;
+  }
+
+  size_t s3fifo_victim(size_t keep)
+  {
+    size_t small_target = (size_t) (_capacity * SMALL_QUEUE_RATIO);
+    while (_small.tail != NIL || _main.tail != NIL)
+    {
+      bool from_small = _small.tail != NIL
+                        && (_small.weight > small_target
+                            || _main.tail == NIL);
+      List &list = from_small ? _small : _main;
+      size_t idx = list.tail;
+      Node &node = _nodes[idx];
+      if (idx == keep)
+      {
+        if (node.prev == NIL)
+        {
+          // the kept node is alone in its queue, take the other one's tail
+          return (from_small ? _main : _small).tail;
+        }
+        unlink (list, idx);
+        push_front (list, idx);
+        continue;
+      }
+      if (from_small)
+      {
+        if (node.freq == 0)
+        {
+          return idx;
+        }
+        // re-accessed while on probation, promote to the main queue
+        node.freq = 0;
+        move_to (_main, idx);
+        continue;
+      }
+      if (node.freq == 0)
+      {
+        return idx;
+      }
+      node.freq--;
+      unlink (_main, idx);
+      push_front (_main, idx);
+    }
+    return NIL;
+  }
+
+  void remember_ghost(const KeyT &key, size_t hash_value)
+  {
+    size_t stamp = ++_ghost_stamp;
+    size_t *old = HashedAccess::find (_ghost, key, hash_value);
+    if (old != nullptr)
+    {
+      *old = stamp;
+    }
+    else
+    {
+      HashedAccess::insert (_ghost, key, stamp, hash_value);
+    }
+    _ghost_fifo.push_back (Ghost {key, hash_value, stamp});
+    // keep about as many ghosts as cached entries
+    size_t limit = _index.size () > 0 ? _index.size () : 1;
+    while (_ghost_fifo.size () > limit)
+    {
+      Ghost &oldest = _ghost_fifo.front ();
+      size_t *cur = HashedAccess::find (_ghost, oldest.key, oldest.hash);
+      if (cur != nullptr && *cur == oldest.stamp)
+      {
+        HashedAccess::erase (_ghost, oldest.key, oldest.hash);
+      }
+      _ghost_fifo.pop_front ();
+    }
+  }
+
+  size_t allocate_node()
+  {
+    if (!_free.empty ())
+    {
+      size_t idx = _free.back ();
+      _free.pop_back ();
+      return idx;
+    }
+    _nodes.emplace_back ();
+    return _nodes.size () - 1;
+  }
+
+  /***
+   * removes a node from the index, its queue and the weight count
+   */
+  void release(size_t idx, size_t hash_value)
+  {
+    Node &node = _nodes[idx];
+    if (_policy != EvictionPolicy::CLOCK)
+    {
+      unlink (list_of (node), idx);
+    }
+    HashedAccess::erase (_index, node.key, hash_value);
+    _weight -= node.weight;
+    node.used = false;
+    node.key = KeyT ();
+    node.value = ValueT ();
+    _free.push_back (idx);
+  }
+
+  void push_front(List &list, size_t idx)
+  {
+    Node &node = _nodes[idx];
+    node.prev = NIL;
+    node.next = list.head;
+    if (list.head != NIL)
+    {
+      _nodes[list.head].prev = idx;
+    }
+    list.head = idx;
+    if (list.tail == NIL)
+    {
+      list.tail = idx;
+    }
+    list.weight += node.weight;
+  }
+
+  void unlink(List &list, size_t idx)
+  {
+    Node &node = _nodes[idx];
+    if (node.prev != NIL)
+    {
+      _nodes[node.prev].next = node.next;
+    }
+    else
+    {
+      list.head = node.next;
+    }
+    if (node.next != NIL)
+    {
+      _nodes[node.next].prev = node.prev;
+    }
+    else
+    {
+      list.tail = node.prev;
+    }
+    node.prev = node.next = NIL;
+    list.weight -= node.weight;
+  }
+
+  void move_to(List &list, size_t idx)
+  {
+    unlink (list_of (_nodes[idx]), idx);
+    _nodes[idx].queue = &list == &_small ? SMALL : MAIN;
+    push_front (list, idx);
+  }
+};
+
+template <typename KeyT, typename ValueT>
+constexpr size_t CacheMap<KeyT, ValueT>::NIL;
+
+/***
+ * a CacheMap split into independently locked shards for multi threaded use.
+ * the shard is picked from the same hash the shard uses for its lookup.
+ */
+template <typename KeyT, typename ValueT>
+class ShardedCacheMap
+{
+  struct Shard
+  {
+    std::mutex lock;
+    CacheMap<KeyT, ValueT> cache;
+
+    Shard(size_t capacity, EvictionPolicy policy, CapacityUnit unit,
+          typename CacheMap<KeyT, ValueT>::Weigher weigher) :
+        cache (capacity, policy, unit, weigher) {}
+  };
+
+  std::vector<std::unique_ptr<Shard>> _shards;
+  unsigned int _shift;
+
+ public:
+  /***
+   * @param capacity total capacity, split evenly between the shards with
+   * the remainder spread one unit each over the first shards
+   * @param shards number of shards, rounded up to a power of 2
+   */
+  ShardedCacheMap(size_t capacity, size_t shards = DEFAULT_SHARDS,
+                  EvictionPolicy policy = EvictionPolicy::LRU,
+                  CapacityUnit unit = CapacityUnit::ENTRIES,
+                  typename CacheMap<KeyT, ValueT>::Weigher weigher = nullptr)
+  {
+    _shift = top_bits_shift (shards);
+    size_t count = top_bits_count (_shift);
+    if (capacity < count)
+    {
+      throw std::invalid_argument (INVALID_CAPACITY_ERROR);
+    }
+    size_t remainder = capacity % count;
+    for (size_t i = 0; i < count; i++)
+    {
+      size_t shard_capacity = capacity / count + (i < remainder ? 1 : 0);
+      _shards.emplace_back (new Shard (shard_capacity, policy, unit,
+                                       weigher));
+    }
+  }
+
+  bool get(const KeyT &key, ValueT &value)
+  {
+    size_t hash_value = std::hash<KeyT> {} (key);
+    Shard &shard = shard_of (hash_value);
+    std::lock_guard<std::mutex> guard (shard.lock);
+    return shard.cache.get_hashed (key, hash_value, value);
+  }
+
+  bool put(const KeyT &key, ValueT value)
+  {
+    size_t hash_value = std::hash<KeyT> {} (key);
+    Shard &shard = shard_of (hash_value);
+    std::lock_guard<std::mutex> guard (shard.lock);
+    return shard.cache.put_hashed (key, hash_value, std::move (value));
+  }
+
+  bool erase(const KeyT &key)
+  {
+    size_t hash_value = std::hash<KeyT> {} (key);
+    Shard &shard = shard_of (hash_value);
+    std::lock_guard<std::mutex> guard (shard.lock);
+    return shard.cache.erase_hashed (key, hash_value);
+  }
+
+  size_t size() const
+  {
+    size_t total = 0;
+    for (const auto &shard : _shards)
+    {
+      std::lock_guard<std::mutex> guard (shard->lock);
+      total += shard->cache.size ();
+    }
+    return total;
+  }
+
+  size_t shard_count() const
+  {
+    return _shards.size ();
+  }
+
+  /***
+   * @return the total capacity of the shards
+   */
+  size_t capacity() const
+  {
+    size_t total = 0;
+    for (const auto &shard : _shards)
+    {
+      total += shard->cache.capacity ();
+    }
+    return total;
+  }
+
+  /***
+   * sums the counters of all shards
+   */
+  CacheStats stats() const
+  {
+    CacheStats total;
+    for (const auto &shard : _shards)
+    {
+      std::lock_guard<std::mutex> guard (shard->lock);
+      total.hits += shard->cache.stats ().hits;
+      total.misses += shard->cache.stats ().misses;
+      total.evictions += shard->cache.stats ().evictions;
+    }
+    return total;
+  }
+
+  void clear()
+  {
+    for (auto &shard : _shards)
+    {
+      std::lock_guard<std::mutex> guard (shard->lock);
+      shard->cache.clear ();
+    }
+  }
+
+ private:
+  Shard &shard_of(size_t hash_value) const
+  {
+    return *_shards[top_bits_idx (hash_value, _shift)];
+  }
+};
+
+#endif //_CACHEMAP_HPP_
@@ -0,0 +1,577 @@
+#ifndef _COMPACTDICTIONARY_HPP_
+#define _COMPACTDICTIONARY_HPP_
+#define INLINE_STRING_BYTES 12
+#define INTERNED_FLAG 0x80000000U
+#define EMPTY_LENGTH 0xFFFFFFFFU
+#define MIN_ARENA_COMPACT 4096
+#define STRING_TOO_LONG_ERROR "string is too long for a compact dictionary"
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include "Dictionary.hpp"
+
+/***
+ * a string to string dictionary that keeps no std::string per entry.
+ * strings of up to 12 bytes are stored inside the slot, longer ones in a
+ * shared byte arena as offset and length. long values can be interned, so
+ * repeated values share one copy. slots are one open addressing array
+ * with linear probing, so a lookup walks consecutive memory.
+ */
+class CompactDictionary
+{
+  struct PackedString
+  {
+    // EMPTY_LENGTH marks a free slot, INTERNED_FLAG a string in the pool
+    uint32_t length = EMPTY_LENGTH;
+    // the bytes themselves, or the arena offset when they do not fit
+    char data[INLINE_STRING_BYTES];
+  };
+
+  struct Slot
+  {
+    size_t hash = 0;
+    PackedString key;
+    PackedString value;
+  };
+
+  std::vector<Slot> _slots;
+  size_t _size = 0;
+  // keys and values longer than INLINE_STRING_BYTES
+  std::vector<char> _arena;
+  size_t _dead_bytes = 0;
+  // interned values, each after a reference count of the slots using it
+  std::vector<char> _pool;
+  size_t _pool_dead_bytes = 0;
+  HashMap<std::string, size_t> _interned;
+  bool _intern_values;
+
+ public:
+  class ConstIterator
+  {
+    const CompactDictionary *_dict;
+    size_t _idx;
+    std::pair<std::string, std::string> _current;
+
+   public:
+    typedef std::pair<std::string, std::string> value_type;
+    typedef const value_type &reference;
+    typedef const value_type *pointer;
+    typedef int difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    ConstIterator(const CompactDictionary *dict, size_t idx) :
+        _dict (dict), _idx (idx)
+    {
+      skip_empty ();
+    }
+
+    ConstIterator &operator++()
+    {
+      _idx++;
+      skip_empty ();
+      return *this;
+    }
+
+    ConstIterator operator++(int)
+    {
+      ConstIterator it (*this);
+      this->operator++ ();
+      return it;
+    }
+
+    bool operator==(const ConstIterator &rhs) const
+    {
+      return _dict == rhs._dict && _idx == rhs._idx;
+    }
+
+    bool operator!=(const ConstIterator &rhs) const
+    {
+      return !operator== (rhs);
+    }
+
+    reference operator*() const
+    {
+      return _current;
+    }
+
+    pointer operator->() const
+    {
+      return &_current;
+    }
+
+   private:
+    void skip_empty()
+    {
+      while (_idx < _dict->_slots.size ()
+             && _dict->_slots[_idx].key.length == EMPTY_LENGTH)
+      {
+        _idx++;
+      }
+      if (_idx < _dict->_slots.size ())
+      {
+        const Slot &slot = _dict->_slots[_idx];
+        _current.first = _dict->unpack (slot.key);
+        _current.second = _dict->unpack (slot.value);
+      }
+    }
+  };
+
+  using const_iterator = ConstIterator;
+
+  /***
+   * @param intern_values store each distinct long value once
+   */
+  explicit CompactDictionary(bool intern_values = false) :
+      _slots (INITIAL_SIZE), _intern_values (intern_values) {}
+
+  const_iterator cbegin() const
+  {
+    return ConstIterator (this, 0);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin ();
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator (this, _slots.size ());
+  }
+
+  const_iterator end() const
+  {
+    return cend ();
+  }
+
+  size_t size() const
+  {
+    return _size;
+  }
+
+  size_t capacity() const
+  {
+    return _slots.size ();
+  }
+
+  bool empty() const
+  {
+    return _size == 0;
+  }
+
+  double get_load_factor() const
+  {
+    return ((double) _size) / ((double) _slots.size ());
+  }
+
+  bool contains_key(const std::string &key) const
+  {
+    return find (key, std::hash<std::string> {} (key)) != NOT_FOUND;
+  }
+
+/*****
+ * returns a copy of the value of a key, throws if it is not inside
+ * @param key
+ * @return the value
+ */
+  std::string at(const std::string &key) const
+  {
+    size_t idx = find (key, std::hash<std::string> {} (key));
+    if (idx == NOT_FOUND)
+    {
+      throw std::runtime_error (ERROR_AT_MSG);
+    }
+    return unpack (_slots[idx].value);
+  }
+
+/***
+ * inserts a key and value if the key is not inside
+ * @return true if inserted
+ */
+  bool insert(const std::string &key, const std::string &value)
+  {
+    size_t hash_value = std::hash<std::string> {} (key);
+    if (find (key, hash_value) != NOT_FOUND)
+    {
+      return false;
+    }
+    add (key, value, hash_value);
+    return true;
+  }
+
+/***
+ * inserts a key or replaces its value
+ * @param key
+ * @param value
+ */
+  void set(const std::string &key, const std::string &value)
+  {
+    size_t hash_value = std::hash<std::string> {} (key);
+    size_t idx = find (key, hash_value);
+    if (idx == NOT_FOUND)
+    {
+      add (key, value, hash_value);
+      return;
+    }
+    // packed first, so a value set again keeps its interned copy
+    PackedString old = _slots[idx].value;
+    _slots[idx].value = pack_value (value);
+    release (old);
+    compact_if_needed ();
+  }
+
+/*****
+ * gets a key in dictionary, and delete it from the dictionary
+ * @param key
+ * @return true if the key is inside and was deleted
+ */
+  bool erase(const std::string &key)
+  {
+    size_t idx = find (key, std::hash<std::string> {} (key));
+    if (idx == NOT_FOUND)
+    {
+      throw InvalidKey ();
+    }
+    release (_slots[idx].key);
+    release (_slots[idx].value);
+    remove_slot (idx);
+    _size--;
+    shrink_to_load ();
+    compact_if_needed ();
+    return true;
+  }
+
+  /***
+   * get a forward iterator for the begin and end insert all objects inside
+   * @tparam ForwardIt
+   * @param begin
+   * @param end
+   */
+  template<class ForwardIt>
+  void update(ForwardIt begin, ForwardIt end)
+  {
+    for (auto it = begin; it != end; it++)
+    {
+      set (it->first, it->second);
+    }
+  }
+
+  /***
+   * deletes all items, the capacity is kept
+   */
+  CompactDictionary &clear()
+  {
+    _slots.assign (_slots.size (), Slot ());
+    _size = 0;
+    _arena.clear ();
+    _dead_bytes = 0;
+    _pool.clear ();
+    _pool_dead_bytes = 0;
+    _interned.clear ();
+    return *this;
+  }
+
+  /***
+   * @return bytes held by the slots, the arenas and the intern index
+   */
+  size_t memory_bytes() const
+  {
+    size_t interned = 0;
+    for (const auto &cur : _interned)
+    {
+      interned += sizeof (cur) + cur.first.capacity ();
+    }
+    return _slots.capacity () * sizeof (Slot) + _arena.capacity ()
+           + _pool.capacity () + interned;
+  }
+
+  size_t interned_count() const
+  {
+    return _interned.size ();
+  }
+
+ private:
+  static const size_t NOT_FOUND = SIZE_MAX;
+
+  static size_t offset_of(const PackedString &str)
+  {
+    uint64_t offset;
+    std::memcpy (&offset, str.data, sizeof (offset));
+    return (size_t) offset;
+  }
+
+  static size_t length_of(const PackedString &str)
+  {
+    return str.length & ~INTERNED_FLAG;
+  }
+
+  const char *bytes_of(const PackedString &str) const
+  {
+    if (length_of (str) <= INLINE_STRING_BYTES)
+    {
+      return str.data;
+    }
+    const std::vector<char> &arena = str.length & INTERNED_FLAG ? _pool
+                                                                : _arena;
+    return arena.data () + offset_of (str);
+  }
+
+  std::string unpack(const PackedString &str) const
+  {
+    return std::string (bytes_of (str), length_of (str));
+  }
+
+  bool equals(const PackedString &str, const std::string &key) const
+  {
+    return length_of (str) == key.size ()
+           && std::memcmp (bytes_of (str), key.data (), key.size ()) == 0;
+  }
+
+  /***
+   * @return the free slot test the probing helpers take
+   */
+  auto is_free() const
+  {
+    return [this] (size_t idx) {
+      return _slots[idx].key.length == EMPTY_LENGTH;
+    };
+  }
+
+  /***
+   * @return slot index of the key, NOT_FOUND if it is not inside
+   */
+  size_t find(const std::string &key, size_t hash_value) const
+  {
+    size_t idx = probe_slot (hash_value, _slots.size (), is_free (),
+                             [&] (size_t i) {
+                               return _slots[i].hash == hash_value
+                                      && equals (_slots[i].key, key);
+                             });
+    return _slots[idx].key.length == EMPTY_LENGTH ? NOT_FOUND : idx;
+  }
+
+  /***
+   * packs a string inline or appends it to an arena
+   */
+  static PackedString pack(const std::string &str, std::vector<char> &arena)
+  {
+    if (str.size () >= INTERNED_FLAG)
+    {
+      throw std::length_error (STRING_TOO_LONG_ERROR);
+    }
+    PackedString packed;
+    packed.length = (uint32_t) str.size ();
+    if (str.size () <= INLINE_STRING_BYTES)
+    {
+      std::memcpy (packed.data, str.data (), str.size ());
+      return packed;
+    }
+    uint64_t offset = arena.size ();
+    arena.insert (arena.end (), str.begin (), str.end ());
+    std::memcpy (packed.data, &offset, sizeof (offset));
+    return packed;
+  }
+
+  /***
+   * the reference count stored in the pool right before the bytes
+   */
+  uint64_t refs_of(const std::vector<char> &pool, size_t offset) const
+  {
+    uint64_t refs;
+    std::memcpy (&refs, pool.data () + offset - sizeof (refs), sizeof (refs));
+    return refs;
+  }
+
+  void set_refs(std::vector<char> &pool, size_t offset, uint64_t refs)
+  {
+    std::memcpy (pool.data () + offset - sizeof (refs), &refs, sizeof (refs));
+  }
+
+  PackedString pack_value(const std::string &value)
+  {
+    if (!_intern_values || value.size () <= INLINE_STRING_BYTES)
+    {
+      return pack (value, _arena);
+    }
+    size_t hash_value = std::hash<std::string> {} (value);
+    PackedString packed;
+    packed.length = (uint32_t) value.size () | INTERNED_FLAG;
+    uint64_t offset;
+    const size_t *known = HashedAccess::find (_interned, value, hash_value);
+    if (known != nullptr)
+    {
+      offset = *known;
+      set_refs (_pool, offset, refs_of (_pool, offset) + 1);
+    }
+    else
+    {
+      _pool.resize (_pool.size () + sizeof (uint64_t));
+      offset = offset_of (pack (value, _pool));
+      set_refs (_pool, offset, 1);
+      HashedAccess::insert (_interned, value, offset, hash_value);
+    }
+    std::memcpy (packed.data, &offset, sizeof (offset));
+    return packed;
+  }
+
+  /***
+   * marks the arena bytes of a string as garbage, an interned value is
+   * dropped from the pool when its last slot lets go of it
+   */
+  void release(const PackedString &str)
+  {
+    if (length_of (str) <= INLINE_STRING_BYTES)
+    {
+      return;
+    }
+    if (!(str.length & INTERNED_FLAG))
+    {
+      _dead_bytes += length_of (str);
+      return;
+    }
+    size_t offset = offset_of (str);
+    uint64_t refs = refs_of (_pool, offset) - 1;
+    set_refs (_pool, offset, refs);
+    if (refs == 0)
+    {
+      _interned.erase (unpack (str));
+      _pool_dead_bytes += sizeof (refs) + length_of (str);
+    }
+  }
+
+  void add(const std::string &key, const std::string &value,
+           size_t hash_value)
+  {
+    Slot slot;
+    slot.hash = hash_value;
+    slot.key = pack (key, _arena);
+    slot.value = pack_value (value);
+    place (slot);
+    _size++;
+    if (get_load_factor () > UPPER_FACTOR)
+    {
+      rehash (_slots.size () * INCREASE_BASE);
+    }
+  }
+
+  void place(const Slot &slot)
+  {
+    _slots[free_slot_of (slot.hash, _slots.size (), is_free ())] = slot;
+  }
+
+  /***
+   * frees a slot without leaving a tombstone
+   */
+  void remove_slot(size_t idx)
+  {
+    size_t last = backward_shift (
+        idx, _slots.size (), is_free (),
+        [this] (size_t i) { return _slots[i].hash; },
+        [this] (size_t from, size_t to) { _slots[to] = _slots[from]; });
+    _slots[last] = Slot ();
+  }
+
+  void shrink_to_load()
+  {
+    size_t new_capacity = shrunk_capacity (_size, _slots.size (),
+                                           INITIAL_SIZE);
+    if (new_capacity != _slots.size ())
+    {
+      rehash (new_capacity);
+    }
+  }
+
+  void rehash(size_t new_capacity)
+  {
+    std::vector<Slot> old (new_capacity);
+    old.swap (_slots);
+    for (const Slot &slot : old)
+    {
+      if (slot.key.length != EMPTY_LENGTH)
+      {
+        place (slot);
+      }
+    }
+  }
+
+  /***
+   * rewrites the arena or the pool without garbage once most of it is dead
+   */
+  void compact_if_needed()
+  {
+    if (_dead_bytes >= MIN_ARENA_COMPACT && _dead_bytes * 2 >= _arena.size ())
+    {
+      compact_arena ();
+    }
+    if (_pool_dead_bytes >= MIN_ARENA_COMPACT
+        && _pool_dead_bytes * 2 >= _pool.size ())
+    {
+      compact_pool ();
+    }
+  }
+
+  void compact_arena()
+  {
+    std::vector<char> arena;
+    arena.reserve (_arena.size () - _dead_bytes);
+    for (Slot &slot : _slots)
+    {
+      if (slot.key.length == EMPTY_LENGTH)
+      {
+        continue;
+      }
+      move_bytes (slot.key, arena);
+      move_bytes (slot.value, arena);
+    }
+    _arena.swap (arena);
+    _dead_bytes = 0;
+  }
+
+  void move_bytes(PackedString &str, std::vector<char> &arena) const
+  {
+    if ((str.length & INTERNED_FLAG) || length_of (str) <= INLINE_STRING_BYTES)
+    {
+      return;
+    }
+    const char *bytes = _arena.data () + offset_of (str);
+    uint64_t offset = arena.size ();
+    arena.insert (arena.end (), bytes, bytes + length_of (str));
+    std::memcpy (str.data, &offset, sizeof (offset));
+  }
+
+  /***
+   * copies the live interned values to a new pool. the old reference
+   * count of each value is overwritten with its new offset, which the
+   * slots then read to follow it
+   */
+  void compact_pool()
+  {
+    std::vector<char> pool;
+    pool.reserve (_pool.size () - _pool_dead_bytes);
+    for (const auto &cur : _interned)
+    {
+      size_t old_offset = cur.second;
+      pool.resize (pool.size () + sizeof (uint64_t));
+      uint64_t offset = pool.size ();
+      pool.insert (pool.end (), cur.first.begin (), cur.first.end ());
+      set_refs (pool, offset, refs_of (_pool, old_offset));
+      set_refs (_pool, old_offset, offset);
+      *HashedAccess::find (_interned, cur.first,
+                           std::hash<std::string> {} (cur.first)) = offset;
+    }
+    for (Slot &slot : _slots)
+    {
+      if (slot.key.length == EMPTY_LENGTH
+          || !(slot.value.length & INTERNED_FLAG))
+      {
+        continue;
+      }
+      uint64_t offset = refs_of (_pool, offset_of (slot.value));
+      std::memcpy (slot.value.data, &offset, sizeof (offset));
+    }
+    _pool.swap (pool);
+    _pool_dead_bytes = 0;
+  }
+};
+
+#endif //_COMPACTDICTIONARY_HPP_
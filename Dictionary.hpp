@@ -20,6 +20,7 @@ class Dictionary :public HashMap<std::string, std::string>
 
  Dictionary(HashMap<std::string, std::string> hm) : HashMap<std::string,
  std::string>(hm){}
+  using HashMap::erase;
 /*****
  * gets a key in dictionary, and delete it from the dictionary
  * @param key
@@ -27,9 +28,9 @@ class Dictionary :public HashMap<std::string, std::string>
  */
   bool erase(std::string key) override
   {
-    if(HashMap::contains_key (key))
+    if(HashMap::erase (key))
     {
-      return HashMap::erase (key);
+      return true;
     }
     throw InvalidKey();
   }
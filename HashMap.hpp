@@ -1,16 +1,27 @@
 #ifndef _HASHMAP_HPP_
 #define _HASHMAP_HPP_
 #define INITIAL_SIZE 16
-#define UPPER_FACTOR 0.75
-#define LOWER_FACTOR 0.25
 #define ERROR_AT_MSG "key was not found"
 #define INVALID_VEC_ERROR "vectors and not the same size"
-#define INCREASE_BASE 2
-#define DECREASE_BASE 0.5
+#define INVALID_ITERATOR_ERROR "iterator does not point to an item of this map"
 #define MIN_CAPACITY 1
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+// 0 - plain heap buckets, 1 - transparent huge pages (madvise),
+// 2 - explicit huge pages (MAP_HUGETLB), falling back to transparent ones
+#ifndef HASHMAP_HUGE_PAGES
+#define HASHMAP_HUGE_PAGES 0
+#endif
 #include <vector>
 #include <string>
 #include <stdexcept>
+#include <new>
+#include "HashPolicy.hpp"
+#include "MembershipFilter.hpp"
+#if HASHMAP_HUGE_PAGES && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+class HashedAccess;
 
 template <typename KeyT, typename  ValueT>
 class HashMap
@@ -19,10 +30,14 @@ class HashMap
   typedef std::pair<KeyT, ValueT> cell;
   typedef std::vector<std::pair<KeyT, ValueT>> vec;
 
+  // the only way to the *_hashed lookups from outside
+  friend class HashedAccess;
+
  private:
   vec* _data = nullptr;
-  unsigned int _capacity;
-  unsigned int _size;
+  size_t _capacity;
+  size_t _size;
+  BlockedBloomFilter _filter;
 
 
 /***
@@ -30,9 +45,10 @@ class HashMap
  */
   class ConstIterator
   {
+    friend class HashMap;
     const HashMap* _hash_map;
-    unsigned int _outer_idx;
-    unsigned int _inner_idx;
+    size_t _outer_idx;
+    size_t _inner_idx;
    public:
 
     typedef cell value_type;
@@ -42,8 +58,8 @@ class HashMap
     // - but still required
     typedef std::forward_iterator_tag iterator_category;
 
-    ConstIterator(const HashMap* hash_map, unsigned int out_idx,
-                  unsigned int inner_idx):
+    ConstIterator(const HashMap* hash_map, size_t out_idx,
+                  size_t inner_idx):
     _hash_map
     (hash_map),_outer_idx(out_idx), _inner_idx(inner_idx) {}
 
@@ -56,20 +72,14 @@ class HashMap
       }
       else
       {
+        // past the last item the iterator becomes (capacity, 0), the end
         _outer_idx++;
-        unsigned int cur_outer_idx = _outer_idx;
         while (_outer_idx < _hash_map->_capacity && (_hash_map->_data
                                                     +_outer_idx)->empty())
         {
           _outer_idx++;
         }
         _inner_idx = 0;
-        if(_outer_idx == _hash_map->_capacity)
-        {
-          _outer_idx = cur_outer_idx-1;
-          _inner_idx = _hash_map->_data[_outer_idx].size();
-        }
-
       }
       return *this;
     }
@@ -114,12 +124,8 @@ class HashMap
      */
     const_iterator cbegin() const
     {
-      if(this->empty())
-      {
-        return ConstIterator(this, 0,0);
-      }
-      unsigned int i = 0;
-      while(_data[i].empty() && i<_capacity)
+      size_t i = 0;
+      while(i<_capacity && _data[i].empty())
       {
         i++;
       }
@@ -131,22 +137,13 @@ class HashMap
       return cbegin();
     }
     /***
-     * returns the last item in hash map
+     * returns the iterator past the last item in hash map, it stays valid
+     * until the map is resized
      * @return const iterator
      */
     const_iterator cend() const
     {
-      if(empty())
-      {
-        return ConstIterator(this, 0,0);
-      }
-      unsigned int i = _capacity-1;
-      while (_data[i].empty() && i >=0)
-      {
-        i--;
-      }
-      unsigned int cell_idx = _data[i].size();
-      return ConstIterator(this, i, cell_idx);
+      return ConstIterator(this, _capacity, 0);
     }
     const_iterator end() const
     {
@@ -159,7 +156,7 @@ class HashMap
  */
   HashMap()
   {
-    _data = new std::vector<std::pair<KeyT, ValueT>>[INITIAL_SIZE];
+    _data = allocate_buckets (INITIAL_SIZE);
     _size = 0;
     _capacity = INITIAL_SIZE;
   }
@@ -171,15 +168,15 @@ class HashMap
    */
   HashMap(std::vector<KeyT> vec1, std::vector<ValueT> vec2)
   {
-    _data = new std::vector<std::pair<KeyT, ValueT>>[INITIAL_SIZE];
+    _data = allocate_buckets (INITIAL_SIZE);
     _size = 0;
     _capacity = INITIAL_SIZE;
     if (vec1.size () != vec2.size ())
     {
-      delete[] _data;
+      free_buckets (_data, _capacity);
       throw std::runtime_error (INVALID_VEC_ERROR);
     }
-    for (unsigned int i = 0; i < vec2.size (); i++)
+    for (size_t i = 0; i < vec2.size (); i++)
     {
       operator[] (vec1[i]) = vec2[i];
     }
@@ -191,9 +188,14 @@ class HashMap
    */
   HashMap(HashMap& other)
   {
-    _data = new std::vector<std::pair<KeyT, ValueT>>[INITIAL_SIZE];
+    _data = allocate_buckets (INITIAL_SIZE);
     _size = 0;
     _capacity = INITIAL_SIZE;
+    if(other.has_filter())
+    {
+      enable_filter (other._filter.collects_stats(),
+                     other._filter.max_bytes());
+    }
     for(cell cur_cell:other)
     {
       this->insert (cur_cell.first, cur_cell.second);
@@ -206,9 +208,14 @@ class HashMap
    */
   HashMap(const HashMap& other)
   {
-    _data = new std::vector<std::pair<KeyT, ValueT>>[INITIAL_SIZE];
+    _data = allocate_buckets (INITIAL_SIZE);
     _size = 0;
     _capacity = INITIAL_SIZE;
+    if(other.has_filter())
+    {
+      enable_filter (other._filter.collects_stats(),
+                     other._filter.max_bytes());
+    }
     for(cell cur_cell:other)
     {
       this->insert (cur_cell.first, cur_cell.second);
@@ -219,7 +226,7 @@ class HashMap
  * return the number of items in the hash map
  * @return int
  */
-  unsigned int size() const
+  size_t size() const
   {
     return _size;
   }
@@ -227,7 +234,7 @@ class HashMap
  * return the number of items that can be instore in hashmap
  * @return int
  */
-  unsigned int capacity() const
+  size_t capacity() const
   {
     return _capacity;
   }
@@ -244,15 +251,7 @@ class HashMap
  */
   bool contains_key(KeyT key) const
   {
-    unsigned int idx = get_hash_idx (key);
-    for(auto& cell:_data[idx])
-    {
-      if(cell.first == key)
-      {
-        return true;
-      }
-    }
-    return false;
+    return find_hashed (key, std::hash<KeyT> {} (key)) != nullptr;
   }
 /*****
  * returns the value of the key if exisit in hashmap
@@ -266,7 +265,7 @@ class HashMap
     {
       throw std::runtime_error(ERROR_AT_MSG);
     }
-    unsigned int idx = get_hash_idx (key);
+    size_t idx = get_hash_idx (key);
 
     for( auto& cell:_data[idx])
     {
@@ -289,7 +288,7 @@ class HashMap
     {
       throw std::runtime_error(ERROR_AT_MSG);
     }
-    unsigned int idx = get_hash_idx (key);
+    size_t idx = get_hash_idx (key);
     for(const auto cell:_data[idx])
     {
       if(cell.first == key)
@@ -307,21 +306,76 @@ class HashMap
  */
   virtual bool erase(KeyT key)
   {
-    unsigned int idx = get_hash_idx (key);
-    for(auto it = _data[idx].begin(); it!=_data[idx].end(); ++it)
+    return erase_hashed (key, std::hash<KeyT> {} (key));
+  }
+/***
+ * erases the item an iterator points to. the map is not resized, so the
+ * returned iterator and a previously taken end() stay valid and a loop
+ * can keep erasing. call shrink_to_fit() once the loop is done
+ * @param pos iterator to an item of this map
+ * @return iterator to the item after the erased one
+ */
+  const_iterator erase(const_iterator pos)
+  {
+    if(pos._hash_map != this || pos._outer_idx >= _capacity
+       || pos._inner_idx >= _data[pos._outer_idx].size())
     {
-      if(it->first == key)
+      throw std::invalid_argument (INVALID_ITERATOR_ERROR);
+    }
+    vec& bucket = _data[pos._outer_idx];
+    remove_cell (bucket, pos._inner_idx);
+    refresh_filter();
+    // the bucket's last item was moved into the erased slot
+    if(pos._inner_idx < bucket.size())
+    {
+      return pos;
+    }
+    size_t next = pos._outer_idx + 1;
+    while(next < _capacity && _data[next].empty())
+    {
+      next++;
+    }
+    return ConstIterator(this, next, 0);
+  }
+/***
+ * shrinks the capacity back within the load factor bounds with at most one
+ * rehash, for use after erasing through iterators. iterators are
+ * invalidated if the capacity changes
+ */
+  void shrink_to_fit()
+  {
+    shrink_to_load();
+  }
+/***
+ * erases every item the predicate accepts in one sweep, resizing at most
+ * once at the end
+ * @param pred called with each (key, value) pair
+ * @return number of erased items
+ */
+  template<class Predicate>
+  size_t erase_if(Predicate pred)
+  {
+    size_t erased = 0;
+    for(size_t i = 0; i < _capacity; i++)
+    {
+      vec& bucket = _data[i];
+      size_t j = 0;
+      while(j < bucket.size())
       {
-        _data[idx].erase(it);
-        _size--;
-        while((get_load_factor()<LOWER_FACTOR) & (_capacity != MIN_CAPACITY))
+        if(pred (static_cast<const cell&> (bucket[j])))
         {
-          double_decrease_size();
+          remove_cell (bucket, j);
+          erased++;
+        }
+        else
+        {
+          j++;
         }
-        return true;
       }
     }
-    return false;
+    shrink_to_load();
+    refresh_filter();
+    return erased;
   }
   /***
    * gets the factor load of the hash map the ratio of size and capacity
@@ -339,21 +393,13 @@ class HashMap
  */
   bool insert(KeyT key, ValueT value)
   {
+    size_t hash_value = std::hash<KeyT> {} (key);
     // check if is already inside
-    if(this->contains_key (key))
+    if(find_hashed (key, hash_value) != nullptr)
     {
         return false;
     }
-    // insert the pair
-    std::pair<KeyT, ValueT> cur_pair(key, value);
-    unsigned int indx = get_hash_idx (key);
-    _data[indx].push_back(cur_pair);
-    _size ++;
-    // resize the hash map if needed
-    if (get_load_factor() > UPPER_FACTOR)
-    {
-      double_size();
-    }
+    insert_hashed (key, value, hash_value);
     return true;
   }
   /**
@@ -434,13 +480,13 @@ class HashMap
     {
       return !operator== (other);
     }
-    unsigned int bucket_size(KeyT key) const
+    size_t bucket_size(KeyT key) const
     {
       if(!contains_key (key))
       {
         throw std::runtime_error(ERROR_AT_MSG);
       }
-      unsigned int idx = get_hash_idx (key);
+      size_t idx = get_hash_idx (key);
       return _data[idx].size();
     }
 /***
@@ -449,7 +495,7 @@ class HashMap
  * @param key
  * @return the index
  */
-  unsigned int bucket_index(KeyT key)
+  size_t bucket_index(KeyT key)
     {
       if(!contains_key (key))
       {
@@ -457,16 +503,71 @@ class HashMap
       }
       return get_hash_idx (key);
     }
+/***
+ * keeps a Bloom filter of the keys in front of the buckets, so most lookups
+ * of absent keys are answered without touching them. erased keys keep
+ * their bits until enough of them pile up, then the filter is refilled.
+ * the filter only helps while it fits in cache and is not saturated: past
+ * FILTER_MAX_KEYS_PER_BLOCK keys per 32 byte block of max_bytes it is
+ * suspended until a resize leaves it room again
+ * @param collect_stats count lookups and false positives for
+ * filter_stats(), off by default to keep lookups free of stores
+ * @param max_bytes cap on the filter size, the default keeps it in L2 and
+ * covers up to ~500k keys
+ */
+  void enable_filter(bool collect_stats = false,
+                     size_t max_bytes = FILTER_MAX_BYTES)
+  {
+    _filter.enable (max_bytes);
+    _filter.set_collect_stats (collect_stats);
+    refill_filter();
+  }
+
+  void disable_filter()
+  {
+    _filter.disable();
+  }
+
+  bool has_filter() const
+  {
+    return _filter.enabled();
+  }
+
+  /***
+   * @return true if lookups go through the filter, false if there is none
+   * or it is suspended because the keys outgrew it
+   */
+  bool filter_active() const
+  {
+    return _filter.active();
+  }
+/***
+ * @return lookup counters of the filter, with its measured false
+ * positive rate
+ */
+  FilterStats filter_stats() const
+  {
+    return _filter.stats();
+  }
+
+  void reset_filter_stats() const
+  {
+    _filter.reset_stats();
+  }
     /***
      * deletes all items in hashmap
      */
     HashMap& clear()
     {
-      for(unsigned int i=0; i<_capacity; i++)
+      for(size_t i=0; i<_capacity; i++)
       {
         _data[i].clear();
       }
       _size = 0;
+      if(_filter.enabled())
+      {
+        _filter.rebuild (_capacity, 0);
+      }
       return *this;
     }
 
@@ -479,9 +580,13 @@ class HashMap
       clear();
       if(_capacity != other._capacity)
       {
-        delete _data;
-        _data = new std::vector<std::pair<KeyT, ValueT>>;
+        free_buckets (_data, _capacity);
+        _data = allocate_buckets (other._capacity);
         _capacity = other._capacity;
+        if(_filter.enabled())
+        {
+          _filter.rebuild (_capacity, other._size);
+        }
       }
 //      _size = other._size;
       for(cell cur_cell:other)
@@ -492,19 +597,95 @@ class HashMap
     }
     virtual ~HashMap()
     {
-    clear();
-    delete[] _data;
+    free_buckets (_data, _capacity);
     }
  private:
+  /***
+   * looks a key up using a hash value the caller already computed with
+   * std::hash<KeyT>, so the key is hashed once per access. the hashed
+   * variants are reached through HashedAccess only, a hash that does not
+   * match std::hash<KeyT> would break every later lookup
+   * @param key
+   * @param hash_value
+   * @return pointer to the value, nullptr if the key is not inside
+   */
+  ValueT* find_hashed(const KeyT& key, size_t hash_value)
+  {
+    const HashMap* self = this;
+    return const_cast<ValueT*> (self->find_hashed (key, hash_value));
+  }
+
+  const ValueT* find_hashed(const KeyT& key, size_t hash_value) const
+  {
+    if(_filter.active() && !_filter.may_contain (hash_value))
+    {
+      return nullptr;
+    }
+    for(const auto& cur_cell:_data[fold_hash_idx (hash_value, _capacity)])
+    {
+      if(cur_cell.first == key)
+      {
+        return &cur_cell.second;
+      }
+    }
+    if(_filter.active())
+    {
+      _filter.count_false_positive();
+    }
+    return nullptr;
+  }
+  /***
+   * inserts a key that is known not to be inside, using a precomputed hash
+   * @param key
+   * @param value
+   * @param hash_value
+   * @return reference to the inserted value
+   */
+  ValueT& insert_hashed(const KeyT& key, ValueT value, size_t hash_value)
+  {
+    vec& bucket = _data[fold_hash_idx (hash_value, _capacity)];
+    bucket.emplace_back (key, std::move (value));
+    _size++;
+    if(_filter.active())
+    {
+      _filter.add (hash_value);
+    }
+    if (get_load_factor() > UPPER_FACTOR)
+    {
+      double_size();
+      return *find_hashed (key, hash_value);
+    }
+    return bucket.back().second;
+  }
+  /***
+   * erases a key using a precomputed hash
+   * @param key
+   * @param hash_value
+   * @return true if the key was inside and deleted
+   */
+  bool erase_hashed(const KeyT& key, size_t hash_value)
+  {
+    vec& bucket = _data[fold_hash_idx (hash_value, _capacity)];
+    for(auto it = bucket.begin(); it != bucket.end(); ++it)
+    {
+      if(it->first == key)
+      {
+        remove_cell (bucket, it - bucket.begin());
+        shrink_to_load();
+        refresh_filter();
+        return true;
+      }
+    }
+    return false;
+  }
   /****
  * gets the index of a key in hash map by his key
  * @param key
  * @return int
  */
-  unsigned int get_hash_idx(KeyT key) const
+  size_t get_hash_idx(KeyT key) const
   {
-    unsigned int hash_value = std::hash<KeyT> {} (key);
-    return hash_value &(_capacity -1);
+    return fold_hash_idx (std::hash<KeyT> {} (key), _capacity);
   }
 
   /***
@@ -512,43 +693,212 @@ class HashMap
  */
   void double_size()
   {
-    // make new vector
-    unsigned int new_capacity = _capacity*INCREASE_BASE;
-    vec* temp = new std::vector<std::pair<KeyT, ValueT>>[new_capacity];
-    for(const cell& cur_cell:(*this))
+    rehash (_capacity * INCREASE_BASE);
+  }
+
+  /***
+   * removes a cell by moving the bucket's last cell over it, so the cost
+   * does not depend on the position in the bucket
+   * @param bucket
+   * @param idx
+   */
+  void remove_cell(vec& bucket, size_t idx)
+  {
+    if(idx + 1 != bucket.size())
     {
-      unsigned int indx = std::hash<KeyT> {} (cur_cell.first) &(
-          (new_capacity)-1);
-      temp[indx].push_back(cur_cell);
+      bucket[idx] = std::move (bucket.back());
+    }
+    bucket.pop_back();
+    _size--;
+    if(_filter.active())
+    {
+      _filter.remove();
     }
-    //delete the old data
-    delete [] _data;
-    _data = temp;
-    _capacity =new_capacity;
   }
 
-  /**
-   * resize and rehash the hash map- divided the size by 2
+  /***
+   * rebuilds the filter from the current keys, without touching the buckets
+   */
+  void refill_filter()
+  {
+    _filter.rebuild (_capacity, _size);
+    for(size_t i = 0; i < _capacity && _filter.active(); i++)
+    {
+      for(const cell& cur_cell:_data[i])
+      {
+        _filter.add (std::hash<KeyT> {} (cur_cell.first));
+      }
+    }
+  }
+
+  /***
+   * refills the filter once erased keys make up too much of it, called
+   * after every erase so keys churning at a steady size stay filtered
    */
-  void double_decrease_size()
+  void refresh_filter()
   {
+    if(_filter.active() && _filter.needs_rebuild (_size))
+    {
+      refill_filter();
+    }
+  }
+
+  /***
+   * halves the capacity until the load factor is back above the lower
+   * bound, rehashing once to the final size
+   */
+  void shrink_to_load()
+  {
+    size_t new_capacity = shrunk_capacity (_size, _capacity, MIN_CAPACITY);
+    if(new_capacity != _capacity)
+    {
+      rehash (new_capacity);
+    }
+  }
 
-    // make new vector
-    unsigned int new_capacity = _capacity*DECREASE_BASE;
-    vec* temp = new std::vector<std::pair<KeyT,
-        ValueT>>[new_capacity];
-    for(const cell& cur_cell:(*this))
+  /***
+   * moves every cell into a new bucket array of the given capacity
+   * @param new_capacity a power of 2
+   */
+  void rehash(size_t new_capacity)
+  {
+    vec* temp = allocate_buckets (new_capacity);
+    // rebuilding also drops the bits of erased keys
+    if(_filter.enabled())
+    {
+      _filter.rebuild (new_capacity, _size);
+    }
+    for(size_t i = 0; i < _capacity; i++)
     {
-      unsigned int indx = std::hash<KeyT> {} (cur_cell.first) &(
-          (new_capacity)-1);
-      temp[indx].push_back(cur_cell);
+      for(cell& cur_cell:_data[i])
+      {
+        size_t hash_value = std::hash<KeyT> {} (cur_cell.first);
+        if(_filter.active())
+        {
+          _filter.add (hash_value);
+        }
+        temp[fold_hash_idx (hash_value, new_capacity)].push_back (
+            std::move (cur_cell));
+      }
     }
-    //delete the old one
-    delete [] _data;
+    free_buckets (_data, _capacity);
     _data = temp;
     _capacity = new_capacity;
   }
 
+  /***
+   * number of bytes mapped for a bucket array, or 0 if it lives on the heap
+   * @param capacity
+   * @return size of the mapping
+   */
+  static size_t huge_mapping_size(size_t capacity)
+  {
+#if HASHMAP_HUGE_PAGES && defined(__linux__)
+    size_t bytes = capacity * sizeof (vec);
+    if (bytes >= HUGE_PAGE_SIZE)
+    {
+      return (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    }
+#endif
+    (void) capacity;
+    return 0;
+  }
+
+  /***
+   * allocates an array of empty buckets, large arrays are backed by huge
+   * pages when HASHMAP_HUGE_PAGES is set
+   * @param capacity
+   * @return the bucket array
+   */
+  static vec* allocate_buckets(size_t capacity)
+  {
+    size_t mapped = huge_mapping_size (capacity);
+    if (mapped == 0)
+    {
+      return new vec[capacity];
+    }
+#if HASHMAP_HUGE_PAGES && defined(__linux__)
+    void* mem = MAP_FAILED;
+#if HASHMAP_HUGE_PAGES == 2 && defined(MAP_HUGETLB)
+    mem = mmap (nullptr, mapped, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (mem == MAP_FAILED)
+    {
+      mem = mmap (nullptr, mapped, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (mem == MAP_FAILED)
+      {
+        throw std::bad_alloc ();
+      }
+#ifdef MADV_HUGEPAGE
+      madvise (mem, mapped, MADV_HUGEPAGE);
+#endif
+    }
+    vec* buckets = static_cast<vec*> (mem);
+    for (size_t i = 0; i < capacity; i++)
+    {
+      new (buckets + i) vec ();
+    }
+    return buckets;
+#else
+    return nullptr;
+#endif
+  }
+
+  /***
+   * releases a bucket array made by allocate_buckets
+   * @param buckets
+   * @param capacity the capacity it was allocated with
+   */
+  static void free_buckets(vec* buckets, size_t capacity)
+  {
+    size_t mapped = huge_mapping_size (capacity);
+    if (mapped == 0)
+    {
+      delete[] buckets;
+      return;
+    }
+#if HASHMAP_HUGE_PAGES && defined(__linux__)
+    for (size_t i = 0; i < capacity; i++)
+    {
+      buckets[i].~vec ();
+    }
+    munmap (buckets, mapped);
+#endif
+  }
+
 };
-#endif //_HASHMAP_HPP_
 
+/***
+ * lookups of a HashMap by a hash the caller already computed, for the
+ * containers built on HashMap that hash each key once per operation.
+ * the hash must be std::hash<KeyT> of the key, any other value breaks
+ * the map, so this is not meant for code that merely uses a HashMap
+ */
+class HashedAccess
+{
+ public:
+  template <typename Map, typename Key>
+  static auto find(Map& map, const Key& key, size_t hash_value)
+  -> decltype (map.find_hashed (key, hash_value))
+  {
+    return map.find_hashed (key, hash_value);
+  }
+
+  template <typename Map, typename Key, typename Value>
+  static auto insert(Map& map, const Key& key, Value&& value,
+                     size_t hash_value)
+  -> decltype (map.insert_hashed (key, std::forward<Value> (value),
+                                  hash_value))
+  {
+    return map.insert_hashed (key, std::forward<Value> (value), hash_value);
+  }
+
+  template <typename Map, typename Key>
+  static bool erase(Map& map, const Key& key, size_t hash_value)
+  {
+    return map.erase_hashed (key, hash_value);
+  }
+};
+#endif //_HASHMAP_HPP_
@@ -0,0 +1,160 @@
+#ifndef _HASHPOLICY_HPP_
+#define _HASHPOLICY_HPP_
+#define UPPER_FACTOR 0.75
+#define LOWER_FACTOR 0.25
+#define INCREASE_BASE 2
+#define DECREASE_BASE 0.5
+// 2^64 divided by the golden ratio, an odd constant that spreads the bits
+#define HASH_MIX 0x9E3779B97F4A7C15ULL
+#include <cstddef>
+#include <cstdint>
+
+/***
+ * the sizing and hashing rules every container of this library shares:
+ * power of 2 capacities kept between LOWER_FACTOR and UPPER_FACTOR, slots
+ * picked from the low bits of a folded hash, and a multiplicative mix for
+ * shards, partitions, tags and filter blocks that read the high bits.
+ * the open addressing containers also share their linear probing here,
+ * reaching their own slot layout through small callables
+ */
+
+/****
+ * maps a full hash value to a slot of a table of the given capacity,
+ * folding the upper half of a 64 bit hash into the lower one
+ * @param hash_value
+ * @param capacity a power of 2
+ * @return the slot index
+ */
+inline size_t fold_hash_idx(size_t hash_value, size_t capacity)
+{
+  if (sizeof (size_t) > 4)
+  {
+    hash_value ^= hash_value >> (sizeof (size_t) * 4);
+  }
+  return hash_value & (capacity - 1);
+}
+
+/***
+ * @param hash_value
+ * @return the hash with every bit spread into the high ones, for users
+ * that index by the top bits
+ */
+inline uint64_t mix_hash(size_t hash_value)
+{
+  return (uint64_t) hash_value * HASH_MIX;
+}
+
+/***
+ * @param count number of shards, partitions or blocks wanted
+ * @return the right shift of a mix_hash that keeps just enough top bits to
+ * index count rounded up to a power of 2, 64 when a single one is enough
+ */
+inline unsigned int top_bits_shift(size_t count)
+{
+  unsigned int bits = 0;
+  while (((size_t) 1 << bits) < count)
+  {
+    bits++;
+  }
+  return 64 - bits;
+}
+
+/***
+ * @return the number of indices top_bits_idx gives with this shift
+ */
+inline size_t top_bits_count(unsigned int shift)
+{
+  return (size_t) 1 << (64 - shift);
+}
+
+/***
+ * picks a shard, partition or block from the top bits of the mixed hash,
+ * so it does not depend on the low bits the slot inside it comes from
+ * @param hash_value
+ * @param shift from top_bits_shift
+ */
+inline size_t top_bits_idx(size_t hash_value, unsigned int shift)
+{
+  return shift == 64 ? 0 : (size_t) (mix_hash (hash_value) >> shift);
+}
+
+/***
+ * halves a capacity until the load factor is back above the lower bound
+ * @param size number of items
+ * @param capacity current capacity, a power of 2
+ * @param min_capacity the capacity is never halved below it
+ * @return the capacity to rehash to, capacity itself if it is fine
+ */
+inline size_t shrunk_capacity(size_t size, size_t capacity,
+                              size_t min_capacity)
+{
+  while ((capacity > min_capacity)
+         && ((double) size / (double) capacity < LOWER_FACTOR))
+  {
+    capacity = (size_t) (capacity * DECREASE_BASE);
+  }
+  return capacity;
+}
+
+/***
+ * walks the linear probe run of a hash in an open addressing table
+ * @param hash_value
+ * @param capacity a power of 2
+ * @param is_free tells if the slot of an index is free
+ * @param matches tells if the used slot of an index holds the item
+ * @return the matching slot, or the free slot that ends the run
+ */
+template <typename IsFree, typename Matches>
+size_t probe_slot(size_t hash_value, size_t capacity, IsFree is_free,
+                  Matches matches)
+{
+  size_t mask = capacity - 1;
+  size_t idx = fold_hash_idx (hash_value, capacity);
+  while (!is_free (idx) && !matches (idx))
+  {
+    idx = (idx + 1) & mask;
+  }
+  return idx;
+}
+
+/***
+ * @return the free slot an item of this hash is placed in
+ */
+template <typename IsFree>
+size_t free_slot_of(size_t hash_value, size_t capacity, IsFree is_free)
+{
+  return probe_slot (hash_value, capacity, is_free,
+                     [] (size_t) { return false; });
+}
+
+/***
+ * erases the item of a slot by shifting the following items of its probe
+ * run back, so no tombstones are left
+ * @param idx the slot to erase
+ * @param capacity a power of 2
+ * @param is_free tells if the slot of an index is free
+ * @param hash_of the full hash of the item in a used slot
+ * @param move moves the item of one slot into another
+ * @return the slot left over at the end, for the caller to clear
+ */
+template <typename IsFree, typename HashOf, typename Move>
+size_t backward_shift(size_t idx, size_t capacity, IsFree is_free,
+                      HashOf hash_of, Move move)
+{
+  size_t mask = capacity - 1;
+  size_t next = (idx + 1) & mask;
+  while (!is_free (next))
+  {
+    size_t home = fold_hash_idx (hash_of (next), capacity);
+    // move back unless the slot's home lies in (idx, next]
+    if (((next - home) & mask) >= ((next - idx) & mask))
+    {
+      move (next, idx);
+      idx = next;
+    }
+    next = (next + 1) & mask;
+  }
+  return idx;
+}
+
+#endif //_HASHPOLICY_HPP_
@@ -0,0 +1,277 @@
+#ifndef _MEMBERSHIPFILTER_HPP_
+#define _MEMBERSHIPFILTER_HPP_
+#define FILTER_BLOCK_WORDS 8
+#define FILTER_BITS_PER_SLOT 16
+#define FILTER_MAX_BYTES (512 * 1024)
+// above ~3% false positives, the filter costs more than it saves
+#define FILTER_MAX_KEYS_PER_BLOCK 32
+#define FILTER_ALIGN_BYTES 64
+#define FILTER_REBUILD_RATIO 0.25
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "HashPolicy.hpp"
+
+/***
+ * counters of a membership filter, a false positive is a lookup the filter
+ * let through for a key that was not inside
+ */
+struct FilterStats
+{
+  size_t lookups = 0;
+  size_t filtered = 0;
+  size_t false_positives = 0;
+
+  /***
+   * @return share of the absent keys the filter failed to reject
+   */
+  double false_positive_rate() const
+  {
+    size_t negatives = filtered + false_positives;
+    return negatives == 0 ? 0.0 : (double) false_positives / negatives;
+  }
+};
+
+/***
+ * a split block Bloom filter over std::hash values: every key sets one bit
+ * in each 32 bit word of a single 256 bit block, and the blocks are cache
+ * line aligned, so a query reads one cache line. bits can not be removed,
+ * so erases are counted and the owner rebuilds the filter once
+ * needs_rebuild() says too many are stale.
+ * the size is capped, and once the keys outgrow the cap the filter is
+ * suspended instead of saturating: active() turns false and the owner
+ * skips it until a rebuild for fewer keys.
+ * the counters are only kept when asked for, and are atomic so concurrent
+ * const lookups stay race free
+ */
+class BlockedBloomFilter
+{
+  typedef uint32_t Block[FILTER_BLOCK_WORDS];
+
+  // the words, with room to start the first block on an aligned address
+  std::vector<uint32_t> _storage;
+  uint32_t *_words = nullptr;
+  size_t _blocks = 0;
+  unsigned int _shift = 64;
+  bool _enabled = false;
+  size_t _max_bytes = FILTER_MAX_BYTES;
+  size_t _keys = 0;
+  size_t _stale = 0;
+  bool _collect_stats = false;
+  mutable std::atomic<size_t> _lookups {0};
+  mutable std::atomic<size_t> _filtered {0};
+  mutable std::atomic<size_t> _false_positives {0};
+
+ public:
+  /***
+   * asks for a filter, the owner sizes it with rebuild()
+   * @param max_bytes cap on the size of the bits
+   */
+  void enable(size_t max_bytes)
+  {
+    _enabled = true;
+    _max_bytes = max_bytes;
+  }
+
+  /***
+   * @return true if a filter was asked for, even while it is suspended
+   */
+  bool enabled() const
+  {
+    return _enabled;
+  }
+
+  /***
+   * @return true if the filter holds every key and has to be queried
+   */
+  bool active() const
+  {
+    return _words != nullptr;
+  }
+
+  size_t max_bytes() const
+  {
+    return _max_bytes;
+  }
+
+  /***
+   * resizes for a table of the given capacity and clears every bit, or
+   * suspends the filter if the keys would saturate it under the cap
+   * @param capacity
+   * @param keys number of keys the owner is about to add
+   */
+  void rebuild(size_t capacity, size_t keys)
+  {
+    size_t wanted = capacity * FILTER_BITS_PER_SLOT
+                    / (FILTER_BLOCK_WORDS * 32);
+    size_t max_blocks = _max_bytes / sizeof (Block);
+    unsigned int shift = top_bits_shift (std::min (wanted, max_blocks));
+    size_t blocks = top_bits_count (shift);
+    _keys = 0;
+    _stale = 0;
+    if (keys > blocks * FILTER_MAX_KEYS_PER_BLOCK)
+    {
+      release ();
+      return;
+    }
+    _shift = shift;
+    _blocks = blocks;
+    size_t align_words = FILTER_ALIGN_BYTES / sizeof (uint32_t);
+    _storage.assign (blocks * FILTER_BLOCK_WORDS + align_words - 1, 0);
+    size_t misaligned = (reinterpret_cast<uintptr_t> (_storage.data ())
+                         % FILTER_ALIGN_BYTES) / sizeof (uint32_t);
+    _words = _storage.data () + (misaligned ? align_words - misaligned : 0);
+  }
+
+  /***
+   * releases the bits, the filter passes every query afterwards
+   */
+  void disable()
+  {
+    release ();
+    _enabled = false;
+  }
+
+  /***
+   * records that a key was erased, its bits stay set until the rebuild
+   */
+  void remove()
+  {
+    _stale++;
+  }
+
+  /***
+   * @param live number of keys still inside
+   * @return true once the erased keys are a large share of the set bits
+   */
+  bool needs_rebuild(size_t live) const
+  {
+    return _stale > live * FILTER_REBUILD_RATIO;
+  }
+
+  /***
+   * sets the bits of a key, suspends the filter once it holds too many
+   */
+  void add(size_t hash_value)
+  {
+    if (++_keys > _blocks * FILTER_MAX_KEYS_PER_BLOCK)
+    {
+      release ();
+      return;
+    }
+    uint32_t *block = block_of (hash_value);
+    uint32_t key = (uint32_t) mix_hash (hash_value);
+    for (int i = 0; i < FILTER_BLOCK_WORDS; i++)
+    {
+      block[i] |= mask (key, i);
+    }
+  }
+
+  /***
+   * @param hash_value
+   * @return false if the key is surely not inside
+   */
+  bool may_contain(size_t hash_value) const
+  {
+    if (_collect_stats)
+    {
+      _lookups.fetch_add (1, std::memory_order_relaxed);
+    }
+    const uint32_t *block = block_of (hash_value);
+    uint32_t key = (uint32_t) mix_hash (hash_value);
+    for (int i = 0; i < FILTER_BLOCK_WORDS; i++)
+    {
+      if ((block[i] & mask (key, i)) == 0)
+      {
+        if (_collect_stats)
+        {
+          _filtered.fetch_add (1, std::memory_order_relaxed);
+        }
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /***
+   * records that a key the filter let through was not inside
+   */
+  void count_false_positive() const
+  {
+    if (_collect_stats)
+    {
+      _false_positives.fetch_add (1, std::memory_order_relaxed);
+    }
+  }
+
+  void set_collect_stats(bool collect_stats)
+  {
+    _collect_stats = collect_stats;
+  }
+
+  bool collects_stats() const
+  {
+    return _collect_stats;
+  }
+
+  /***
+   * @return a snapshot of the counters
+   */
+  FilterStats stats() const
+  {
+    FilterStats stats;
+    stats.lookups = _lookups.load (std::memory_order_relaxed);
+    stats.filtered = _filtered.load (std::memory_order_relaxed);
+    stats.false_positives = _false_positives.load (std::memory_order_relaxed);
+    return stats;
+  }
+
+  void reset_stats() const
+  {
+    _lookups.store (0, std::memory_order_relaxed);
+    _filtered.store (0, std::memory_order_relaxed);
+    _false_positives.store (0, std::memory_order_relaxed);
+  }
+
+  size_t memory_bytes() const
+  {
+    return _storage.size () * sizeof (uint32_t);
+  }
+
+ private:
+  void release()
+  {
+    _storage.clear ();
+    _storage.shrink_to_fit ();
+    _words = nullptr;
+    _blocks = 0;
+    _shift = 64;
+  }
+
+  static uint32_t mask(uint32_t key, int word)
+  {
+    static const uint32_t salts[FILTER_BLOCK_WORDS] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+    return 1U << ((key * salts[word]) >> 27);
+  }
+
+  size_t block_index(size_t hash_value) const
+  {
+    return top_bits_idx (hash_value, _shift);
+  }
+
+  uint32_t *block_of(size_t hash_value)
+  {
+    return &_words[block_index (hash_value) * FILTER_BLOCK_WORDS];
+  }
+
+  const uint32_t *block_of(size_t hash_value) const
+  {
+    return &_words[block_index (hash_value) * FILTER_BLOCK_WORDS];
+  }
+};
+
+#endif //_MEMBERSHIPFILTER_HPP_
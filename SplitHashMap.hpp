@@ -0,0 +1,515 @@
+#ifndef _SPLITHASHMAP_HPP_
+#define _SPLITHASHMAP_HPP_
+#define EMPTY_TAG 0
+#include <cstdint>
+#include <iterator>
+#include "HashMap.hpp"
+
+/***
+ * a hash map with the HashMap interface that keeps keys and values in
+ * separate arrays: a byte of hash per slot, the keys, and the values.
+ * a probe reads the tag bytes and compares keys only on a tag match, the
+ * value array is read only on a hit. open addressing with linear probing
+ * and backward shift deletion. the full hashes are kept aside, so deleting
+ * and resizing never hash a key again.
+ */
+template <typename KeyT, typename ValueT>
+class SplitHashMap
+{
+  typedef std::pair<KeyT, ValueT> cell;
+
+  // EMPTY_TAG, or the top 7 bits of the mixed hash with the high bit set
+  std::vector<uint8_t> _tags;
+  std::vector<KeyT> _keys;
+  std::vector<ValueT> _values;
+  // the full hash of each slot, read only when slots move
+  std::vector<size_t> _hashes;
+  size_t _size = 0;
+
+  /***
+   * the item an iterator points to, references into both arrays. it
+   * converts to the std::pair HashMap's iterator yields, so code written
+   * against HashMap keeps compiling, at the price of a copy
+   */
+  struct CellRef
+  {
+    const KeyT &first;
+    const ValueT &second;
+
+    operator std::pair<KeyT, ValueT>() const
+    {
+      return std::pair<KeyT, ValueT> (first, second);
+    }
+  };
+
+  class CellPtr
+  {
+    CellRef _ref;
+   public:
+    explicit CellPtr(CellRef ref) : _ref (ref) {}
+
+    const CellRef *operator->() const
+    {
+      return &_ref;
+    }
+  };
+
+/***
+ * *** const iterator class***
+ * walks the slots starting after a free one, so no probe run wraps past
+ * the end of the walk. erasing through the iterator only shifts items
+ * back along the walk, and each item is still seen once
+ */
+  class ConstIterator
+  {
+    friend class SplitHashMap;
+    const SplitHashMap *_map;
+    // the free slot the walk starts after, and the steps taken from it
+    size_t _start;
+    size_t _step;
+
+   public:
+    typedef cell value_type;
+    typedef CellRef reference;
+    typedef CellPtr pointer;
+    typedef int difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    ConstIterator(const SplitHashMap *map, size_t start, size_t step) :
+        _map (map), _start (start), _step (step)
+    {
+      skip_empty ();
+    }
+
+    ConstIterator &operator++()
+    {
+      _step++;
+      skip_empty ();
+      return *this;
+    }
+
+    ConstIterator operator++(int)
+    {
+      ConstIterator it (*this);
+      this->operator++ ();
+      return it;
+    }
+
+    bool operator==(const ConstIterator &rhs) const
+    {
+      // every finished walk equals end(), wherever it started
+      return _map == rhs._map && _step == rhs._step
+             && (_step == _map->_tags.size () || _start == rhs._start);
+    }
+
+    bool operator!=(const ConstIterator &rhs) const
+    {
+      return !operator== (rhs);
+    }
+
+    reference operator*() const
+    {
+      size_t idx = index ();
+      return CellRef {_map->_keys[idx], _map->_values[idx]};
+    }
+
+    pointer operator->() const
+    {
+      return CellPtr (operator* ());
+    }
+
+   private:
+    size_t index() const
+    {
+      return (_start + _step) & (_map->_tags.size () - 1);
+    }
+
+    void skip_empty()
+    {
+      while (_step < _map->_tags.size ()
+             && _map->_tags[index ()] == EMPTY_TAG)
+      {
+        _step++;
+      }
+    }
+  };
+
+ public:
+  using const_iterator = ConstIterator;
+
+  const_iterator cbegin() const
+  {
+    return ConstIterator (this, free_slot (), 1);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin ();
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator (this, 0, _tags.size ());
+  }
+
+  const_iterator end() const
+  {
+    return cend ();
+  }
+
+  SplitHashMap() : _tags (INITIAL_SIZE, EMPTY_TAG), _keys (INITIAL_SIZE),
+                   _values (INITIAL_SIZE), _hashes (INITIAL_SIZE) {}
+
+  /***
+   * gets 2 vectors and inserts the vectors values by key and value from
+   * each vector
+   * @param vec1
+   * @param vec2
+   */
+  SplitHashMap(const std::vector<KeyT> &vec1,
+               const std::vector<ValueT> &vec2) : SplitHashMap ()
+  {
+    if (vec1.size () != vec2.size ())
+    {
+      throw std::runtime_error (INVALID_VEC_ERROR);
+    }
+    for (size_t i = 0; i < vec2.size (); i++)
+    {
+      operator[] (vec1[i]) = vec2[i];
+    }
+  }
+
+  size_t size() const
+  {
+    return _size;
+  }
+
+  size_t capacity() const
+  {
+    return _tags.size ();
+  }
+
+  bool empty() const
+  {
+    return _size == 0;
+  }
+
+  double get_load_factor() const
+  {
+    return ((double) _size) / ((double) _tags.size ());
+  }
+
+/***
+ * checks if a key is inside, reading only tags and keys
+ * @param key
+ * @return true if inside else false
+ */
+  bool contains_key(const KeyT &key) const
+  {
+    return find (key, std::hash<KeyT> {} (key)) != NOT_FOUND;
+  }
+
+/*****
+ * returns the value of the key if exisit in hashmap
+ * else throw exception
+ * @param key
+ * @return the value by reference open for edits
+ */
+  ValueT &at(const KeyT &key)
+  {
+    size_t idx = find (key, std::hash<KeyT> {} (key));
+    if (idx == NOT_FOUND)
+    {
+      throw std::runtime_error (ERROR_AT_MSG);
+    }
+    return _values[idx];
+  }
+
+  const ValueT &at(const KeyT &key) const
+  {
+    size_t idx = find (key, std::hash<KeyT> {} (key));
+    if (idx == NOT_FOUND)
+    {
+      throw std::runtime_error (ERROR_AT_MSG);
+    }
+    return _values[idx];
+  }
+
+/***
+ * gets a key and value amd insert if to the hash map
+ * @param key
+ * @param value
+ * @return true if wast exisit else false
+ */
+  bool insert(const KeyT &key, const ValueT &value)
+  {
+    size_t hash_value = std::hash<KeyT> {} (key);
+    if (find (key, hash_value) != NOT_FOUND)
+    {
+      return false;
+    }
+    add (key, value, hash_value);
+    return true;
+  }
+
+  /**
+   * gets a key and return his value in hash map if was exisit,
+   * if not  it creates and return the reference to the value
+   * with the option to edit it
+   * @param key
+   * @return value by reference
+   */
+  ValueT &operator[](const KeyT &key)
+  {
+    size_t hash_value = std::hash<KeyT> {} (key);
+    size_t idx = find (key, hash_value);
+    if (idx == NOT_FOUND)
+    {
+      idx = add (key, ValueT (), hash_value);
+    }
+    return _values[idx];
+  }
+
+  ValueT operator[](const KeyT &key) const
+  {
+    size_t idx = find (key, std::hash<KeyT> {} (key));
+    return idx == NOT_FOUND ? ValueT () : _values[idx];
+  }
+
+/***
+ * gets aa key and erase it from hash map
+ * @param key
+ * @return true if exists and deleted false if wasnt exist
+ */
+  bool erase(const KeyT &key)
+  {
+    size_t idx = find (key, std::hash<KeyT> {} (key));
+    if (idx == NOT_FOUND)
+    {
+      return false;
+    }
+    remove_slot (idx);
+    _size--;
+    shrink_to_load ();
+    return true;
+  }
+
+/***
+ * erases the item an iterator points to. the map is not resized, so the
+ * returned iterator and a previously taken end() stay valid and a loop
+ * can keep erasing. call shrink_to_fit() once the loop is done
+ * @param pos iterator to an item of this map
+ * @return iterator to the item after the erased one
+ */
+  const_iterator erase(const_iterator pos)
+  {
+    if (pos._map != this || pos._step >= _tags.size ()
+        || _tags[pos.index ()] == EMPTY_TAG)
+    {
+      throw std::invalid_argument (INVALID_ITERATOR_ERROR);
+    }
+    remove_slot (pos.index ());
+    _size--;
+    // an item shifted back into the slot is the next one, the free slot
+    // the walk started after is never filled
+    return ConstIterator (this, pos._start, pos._step);
+  }
+
+/***
+ * shrinks the capacity back within the load factor bounds with at most one
+ * rehash, for use after erasing through iterators
+ */
+  void shrink_to_fit()
+  {
+    shrink_to_load ();
+  }
+
+/***
+ * erases every item the predicate accepts, resizing at most once
+ * @param pred called with each item as a proxy with first and second
+ * members. the proxy converts to std::pair, but a const auto& parameter
+ * avoids copying every item
+ * @return number of erased items
+ */
+  template<class Predicate>
+  size_t erase_if(Predicate pred)
+  {
+    size_t erased = 0;
+    size_t mask = _tags.size () - 1;
+    // start after a free slot: no probe run crosses it, so items only
+    // shift back into the current slot and each one is seen once
+    size_t start = free_slot ();
+    size_t step = 1;
+    while (step <= mask)
+    {
+      size_t idx = (start + step) & mask;
+      if (_tags[idx] != EMPTY_TAG
+          && pred (CellRef {_keys[idx], _values[idx]}))
+      {
+        remove_slot (idx);
+        _size--;
+        erased++;
+        continue;
+      }
+      step++;
+    }
+    shrink_to_load ();
+    return erased;
+  }
+
+  /***
+   * deletes all items in hashmap, the capacity is kept
+   */
+  SplitHashMap &clear()
+  {
+    size_t capacity = _tags.size ();
+    _tags.assign (capacity, EMPTY_TAG);
+    _keys.assign (capacity, KeyT ());
+    _values.assign (capacity, ValueT ());
+    _hashes.assign (capacity, 0);
+    _size = 0;
+    return *this;
+  }
+
+  bool operator==(const SplitHashMap &other) const
+  {
+    if (_size != other._size)
+    {
+      return false;
+    }
+    for (const auto &cur : *this)
+    {
+      size_t idx = other.find (cur.first, std::hash<KeyT> {} (cur.first));
+      if (idx == NOT_FOUND || !(other._values[idx] == cur.second))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const SplitHashMap &other) const
+  {
+    return !operator== (other);
+  }
+
+ private:
+  static const size_t NOT_FOUND = SIZE_MAX;
+
+  /***
+   * @return the first free slot, there is always one under UPPER_FACTOR
+   */
+  size_t free_slot() const
+  {
+    size_t idx = 0;
+    while (_tags[idx] != EMPTY_TAG)
+    {
+      idx++;
+    }
+    return idx;
+  }
+
+  static uint8_t tag_of(size_t hash_value)
+  {
+    return (uint8_t) (0x80 | (mix_hash (hash_value) >> 57));
+  }
+
+  /***
+   * @return the free slot test the probing helpers take
+   */
+  auto is_free() const
+  {
+    return [this] (size_t idx) { return _tags[idx] == EMPTY_TAG; };
+  }
+
+  size_t find(const KeyT &key, size_t hash_value) const
+  {
+    uint8_t tag = tag_of (hash_value);
+    size_t idx = probe_slot (hash_value, _tags.size (), is_free (),
+                             [&] (size_t i) {
+                               return _tags[i] == tag && _keys[i] == key;
+                             });
+    return _tags[idx] == EMPTY_TAG ? NOT_FOUND : idx;
+  }
+
+  /***
+   * inserts a key known not to be inside
+   * @return the slot it ended up in
+   */
+  size_t add(const KeyT &key, const ValueT &value, size_t hash_value)
+  {
+    size_t idx = place (key, value, hash_value);
+    _size++;
+    if (get_load_factor () > UPPER_FACTOR)
+    {
+      rehash (_tags.size () * INCREASE_BASE);
+      idx = find (key, hash_value);
+    }
+    return idx;
+  }
+
+  size_t place(const KeyT &key, const ValueT &value, size_t hash_value)
+  {
+    size_t idx = free_slot_of (hash_value, _tags.size (), is_free ());
+    _tags[idx] = tag_of (hash_value);
+    _keys[idx] = key;
+    _values[idx] = value;
+    _hashes[idx] = hash_value;
+    return idx;
+  }
+
+  /***
+   * frees a slot without leaving a tombstone
+   */
+  void remove_slot(size_t idx)
+  {
+    idx = backward_shift (
+        idx, _tags.size (), is_free (),
+        [this] (size_t i) { return _hashes[i]; },
+        [this] (size_t from, size_t to) {
+          _tags[to] = _tags[from];
+          _keys[to] = std::move (_keys[from]);
+          _values[to] = std::move (_values[from]);
+          _hashes[to] = _hashes[from];
+        });
+    _tags[idx] = EMPTY_TAG;
+    _keys[idx] = KeyT ();
+    _values[idx] = ValueT ();
+  }
+
+  void shrink_to_load()
+  {
+    size_t new_capacity = shrunk_capacity (_size, _tags.size (),
+                                           INITIAL_SIZE);
+    if (new_capacity != _tags.size ())
+    {
+      rehash (new_capacity);
+    }
+  }
+
+  void rehash(size_t new_capacity)
+  {
+    std::vector<uint8_t> tags (new_capacity, EMPTY_TAG);
+    std::vector<KeyT> keys (new_capacity);
+    std::vector<ValueT> values (new_capacity);
+    std::vector<size_t> hashes (new_capacity);
+    tags.swap (_tags);
+    keys.swap (_keys);
+    values.swap (_values);
+    hashes.swap (_hashes);
+    for (size_t i = 0; i < tags.size (); i++)
+    {
+      if (tags[i] == EMPTY_TAG)
+      {
+        continue;
+      }
+      size_t idx = free_slot_of (hashes[i], new_capacity, is_free ());
+      _tags[idx] = tags[i];
+      _keys[idx] = std::move (keys[i]);
+      _values[idx] = std::move (values[i]);
+      _hashes[idx] = hashes[i];
+    }
+  }
+};
+
+#endif //_SPLITHASHMAP_HPP_
@@ -0,0 +1,88 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Dictionary.hpp"
+#define ENTRIES 1000000
+#define LOOKUPS 5000000
+#define KEY_PREFIX "user:session:"
+// the default cap covers ~500k keys, give the filter room for all of them
+#define FILTER_BYTES (4 * 1024 * 1024)
+
+/***
+ * builds the lookup keys, miss_ratio of them are not in the dictionary
+ */
+std::vector<std::string> make_queries(double miss_ratio)
+{
+  std::mt19937_64 rng (42);
+  std::uniform_int_distribution<long> present (0, ENTRIES - 1);
+  std::uniform_real_distribution<double> coin (0.0, 1.0);
+  std::vector<std::string> queries;
+  queries.reserve (LOOKUPS);
+  for (long i = 0; i < LOOKUPS; i++)
+  {
+    long id = present (rng);
+    if (coin (rng) < miss_ratio)
+    {
+      id += ENTRIES;
+    }
+    queries.push_back (KEY_PREFIX + std::to_string (id));
+  }
+  return queries;
+}
+
+/***
+ * runs every query through contains_key
+ * @return nanoseconds per lookup
+ */
+double run(const Dictionary &dict, const std::vector<std::string> &queries,
+           size_t &found)
+{
+  found = 0;
+  auto start = std::chrono::steady_clock::now ();
+  for (const std::string &key : queries)
+  {
+    found += dict.contains_key (key);
+  }
+  auto end = std::chrono::steady_clock::now ();
+  return std::chrono::duration<double, std::nano> (end - start).count ()
+         / queries.size ();
+}
+
+int main()
+{
+  Dictionary plain;
+  Dictionary filtered;
+  filtered.enable_filter (true, FILTER_BYTES);
+  for (long i = 0; i < ENTRIES; i++)
+  {
+    std::string key = KEY_PREFIX + std::to_string (i);
+    plain.insert (key, "v");
+    filtered.insert (key, "v");
+  }
+  std::cout << "entries: " << ENTRIES << ", lookups: " << LOOKUPS
+            << ", filter "
+            << (filtered.filter_active () ? "active" : "suspended") << "\n";
+  for (double miss_ratio : {0.5, 0.9, 0.99})
+  {
+    std::vector<std::string> queries = make_queries (miss_ratio);
+    size_t plain_found = 0;
+    size_t filtered_found = 0;
+    filtered.reset_filter_stats ();
+    double plain_ns = run (plain, queries, plain_found);
+    double filtered_ns = run (filtered, queries, filtered_found);
+    if (plain_found != filtered_found)
+    {
+      std::cout << "mismatch: " << plain_found << " != " << filtered_found
+                << std::endl;
+      return 1;
+    }
+    std::cout << "miss ratio " << miss_ratio
+              << ": plain " << plain_ns << " ns/op, filtered "
+              << filtered_ns << " ns/op, speedup "
+              << plain_ns / filtered_ns << "x, false positive rate "
+              << filtered.filter_stats ().false_positive_rate () << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AggregationMap.hpp"
+#define CORPUS_WORDS 4000000
+#define VOCABULARY 200000
+
+/***
+ * draws a corpus with a zipf like word distribution
+ */
+std::vector<std::string> make_corpus()
+{
+  std::mt19937_64 rng (7);
+  std::vector<double> weights;
+  for (int rank = 1; rank <= VOCABULARY; rank++)
+  {
+    weights.push_back (1.0 / rank);
+  }
+  std::discrete_distribution<int> zipf (weights.begin (), weights.end ());
+  std::vector<std::string> corpus;
+  corpus.reserve (CORPUS_WORDS);
+  for (int i = 0; i < CORPUS_WORDS; i++)
+  {
+    corpus.push_back ("w" + std::to_string (zipf (rng)));
+  }
+  return corpus;
+}
+
+/***
+ * runs count(begin, end) on equal slices of the corpus in threads
+ * @return milliseconds
+ */
+template <typename Count>
+double run(const std::vector<std::string> &corpus, unsigned int threads,
+           Count count)
+{
+  auto start = std::chrono::steady_clock::now ();
+  std::vector<std::thread> workers;
+  size_t slice = corpus.size () / threads;
+  for (unsigned int t = 0; t < threads; t++)
+  {
+    size_t begin = t * slice;
+    size_t end = t + 1 == threads ? corpus.size () : begin + slice;
+    workers.emplace_back ([&, begin, end] () { count (begin, end); });
+  }
+  for (auto &worker : workers)
+  {
+    worker.join ();
+  }
+  auto end = std::chrono::steady_clock::now ();
+  return std::chrono::duration<double, std::milli> (end - start).count ();
+}
+
+int main()
+{
+  std::vector<std::string> corpus = make_corpus ();
+  unsigned int cores = std::thread::hardware_concurrency ();
+  if (cores == 0)
+  {
+    cores = 1;
+  }
+  std::cout << "words: " << CORPUS_WORDS << ", vocabulary: " << VOCABULARY
+            << ", cores: " << cores << "\n";
+  for (unsigned int threads = 1; threads <= cores; threads *= 2)
+  {
+    HashMap<std::string, int> locked_counts;
+    std::mutex lock;
+    double locked_ms = run (corpus, threads, [&] (size_t begin, size_t end)
+    {
+      for (size_t i = begin; i < end; i++)
+      {
+        std::lock_guard<std::mutex> guard (lock);
+        locked_counts[corpus[i]]++;
+      }
+    });
+
+    AggregationMap<std::string, int> counts;
+    double aggregated_ms = run (corpus, threads, [&] (size_t begin,
+                                                      size_t end)
+    {
+      AggregationMap<std::string, int>::LocalBuffer local (counts);
+      for (size_t i = begin; i < end; i++)
+      {
+        local.add (corpus[i], 1);
+      }
+    });
+    HashMap<std::string, int> merged = counts.merge ();
+    if (merged.size () != locked_counts.size ()
+        || merged.at ("w0") != locked_counts.at ("w0"))
+    {
+      std::cout << "count mismatch" << std::endl;
+      return 1;
+    }
+    std::cout << threads << " threads: single lock " << locked_ms
+              << " ms, aggregation map " << aggregated_ms << " ms, speedup "
+              << locked_ms / aggregated_ms << "x\n";
+  }
+  return 0;
+}
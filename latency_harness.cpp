@@ -0,0 +1,484 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+#include "HashMap.hpp"
+#define SUB_BUCKET_BITS 5
+#define HISTOGRAM_EXPONENTS 64
+#define DEFAULT_OPERATIONS 1000000
+#define USAGE "usage: latency_harness [-n operations] [--steady] [trace-file]\n" \
+              "trace lines: insert <key> <value> | at <key> | erase <key> | " \
+              "index <key> [value]"
+
+/**** allocation tracking ***/
+
+static std::atomic<size_t> allocations (0);
+static std::atomic<size_t> allocated_bytes (0);
+
+void *operator new(size_t size)
+{
+  allocations.fetch_add (1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add (size, std::memory_order_relaxed);
+  void *ptr = std::malloc (size == 0 ? 1 : size);
+  if (ptr == nullptr)
+  {
+    throw std::bad_alloc ();
+  }
+  return ptr;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new (size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+  try
+  {
+    return operator new (size);
+  }
+  catch (const std::bad_alloc &)
+  {
+    return nullptr;
+  }
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept
+{
+  return operator new (size, tag);
+}
+
+void operator delete(void *ptr) noexcept
+{
+  std::free (ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+  std::free (ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+  std::free (ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+  std::free (ptr);
+}
+
+/**** timing ***/
+
+/***
+ * reads rdtsc when available and converts ticks to nanoseconds with a
+ * ratio measured against steady_clock, otherwise uses steady_clock
+ */
+class Clock
+{
+  bool _use_tsc;
+  double _ns_per_tick = 1.0;
+
+ public:
+  explicit Clock(bool use_tsc)
+  {
+#ifdef HAVE_TSC
+    _use_tsc = use_tsc;
+#else
+    (void) use_tsc;
+    _use_tsc = false;
+#endif
+    if (_use_tsc)
+    {
+      calibrate ();
+    }
+  }
+
+  uint64_t now() const
+  {
+#ifdef HAVE_TSC
+    if (_use_tsc)
+    {
+      return __rdtsc ();
+    }
+#endif
+    return std::chrono::duration_cast<std::chrono::nanoseconds> (
+        std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+  }
+
+  uint64_t to_ns(uint64_t ticks) const
+  {
+    return (uint64_t) (ticks * _ns_per_tick);
+  }
+
+  const char *name() const
+  {
+    return _use_tsc ? "rdtsc" : "steady_clock";
+  }
+
+ private:
+  void calibrate()
+  {
+    auto start = std::chrono::steady_clock::now ();
+    uint64_t ticks = now ();
+    while (std::chrono::steady_clock::now () - start
+           < std::chrono::milliseconds (50))
+    {
+    }
+    uint64_t elapsed_ticks = now () - ticks;
+    double elapsed_ns = std::chrono::duration<double, std::nano> (
+        std::chrono::steady_clock::now () - start).count ();
+    _ns_per_tick = elapsed_ns / elapsed_ticks;
+  }
+};
+
+/***
+ * a log-linear histogram in the style of HdrHistogram: values are bucketed
+ * by their highest set bit and the next SUB_BUCKET_BITS bits, so every
+ * bucket is within ~3% of the values it holds
+ */
+class LatencyHistogram
+{
+  static const size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  std::vector<uint64_t> _counts;
+  uint64_t _total = 0;
+  uint64_t _max = 0;
+
+ public:
+  LatencyHistogram() : _counts (HISTOGRAM_EXPONENTS * SUB_BUCKETS, 0) {}
+
+  void record(uint64_t value)
+  {
+    _counts[index_of (value)]++;
+    _total++;
+    if (value > _max)
+    {
+      _max = value;
+    }
+  }
+
+  uint64_t count() const
+  {
+    return _total;
+  }
+
+  uint64_t max() const
+  {
+    return _max;
+  }
+
+  /***
+   * @param percentile between 0 and 100
+   * @return the highest value of the bucket the percentile falls in
+   */
+  uint64_t percentile(double percentile) const
+  {
+    if (_total == 0)
+    {
+      return 0;
+    }
+    uint64_t rank = (uint64_t) std::ceil (percentile / 100.0 * _total);
+    if (rank == 0)
+    {
+      rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < _counts.size (); i++)
+    {
+      seen += _counts[i];
+      if (seen >= rank)
+      {
+        uint64_t top = upper_bound_of (i);
+        return top < _max ? top : _max;
+      }
+    }
+    return _max;
+  }
+
+ private:
+  static size_t index_of(uint64_t value)
+  {
+    if (value < SUB_BUCKETS)
+    {
+      return (size_t) value;
+    }
+    unsigned int exponent = 63 - __builtin_clzll (value);
+    unsigned int shift = exponent - SUB_BUCKET_BITS;
+    size_t sub = (size_t) (value >> shift) & (SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + sub;
+  }
+
+  static uint64_t upper_bound_of(size_t index)
+  {
+    if (index < SUB_BUCKETS)
+    {
+      return index;
+    }
+    unsigned int shift = index / SUB_BUCKETS - 1;
+    uint64_t sub = index % SUB_BUCKETS;
+    return (((SUB_BUCKETS + sub + 1) << shift) - 1);
+  }
+};
+
+/**** operations ***/
+
+enum Operation
+{
+  INSERT,
+  AT,
+  ERASE,
+  INDEX,
+  OPERATIONS
+};
+
+static const char *const operation_names[OPERATIONS] = {
+    "insert", "at", "erase", "operator[]"};
+
+struct Step
+{
+  Operation op;
+  std::string key;
+  std::string value;
+};
+
+struct OperationStats
+{
+  LatencyHistogram latency;
+  size_t allocations = 0;
+  size_t bytes = 0;
+};
+
+/***
+ * reads a recorded trace, one operation per line
+ * @return false if a line can not be parsed
+ */
+bool read_trace(const char *path, std::vector<Step> &steps)
+{
+  std::ifstream in (path);
+  if (!in)
+  {
+    std::cerr << "can not open " << path << std::endl;
+    return false;
+  }
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline (in, line))
+  {
+    line_number++;
+    std::istringstream fields (line);
+    std::string op;
+    Step step;
+    if (!(fields >> op) || op[0] == '#')
+    {
+      continue;
+    }
+    if (op == "insert")
+    {
+      step.op = INSERT;
+    }
+    else if (op == "at")
+    {
+      step.op = AT;
+    }
+    else if (op == "erase")
+    {
+      step.op = ERASE;
+    }
+    else if (op == "index")
+    {
+      step.op = INDEX;
+    }
+    else
+    {
+      std::cerr << path << ":" << line_number << ": unknown operation "
+                << op << std::endl;
+      return false;
+    }
+    if (!(fields >> step.key))
+    {
+      std::cerr << path << ":" << line_number << ": missing key" << std::endl;
+      return false;
+    }
+    fields >> step.value;
+    steps.push_back (step);
+  }
+  return true;
+}
+
+/***
+ * grows the map, reads and updates it, then erases every key, so both
+ * the rehash on growth and the shrinking on erase are recorded
+ */
+std::vector<Step> make_workload(size_t operations)
+{
+  size_t keys = operations / 4;
+  std::mt19937_64 rng (1);
+  std::uniform_int_distribution<size_t> pick (0, keys - 1);
+  std::vector<Step> steps;
+  steps.reserve (operations);
+  for (size_t i = 0; i < keys; i++)
+  {
+    steps.push_back (Step {INSERT, "key" + std::to_string (i),
+                           "value" + std::to_string (i)});
+  }
+  for (size_t i = 0; i < keys; i++)
+  {
+    steps.push_back (Step {AT, "key" + std::to_string (pick (rng)), ""});
+    steps.push_back (Step {INDEX, "key" + std::to_string (pick (rng)), "v"});
+  }
+  for (size_t i = 0; i < keys; i++)
+  {
+    steps.push_back (Step {ERASE, "key" + std::to_string (i), ""});
+  }
+  return steps;
+}
+
+/***
+ * makes the compiler treat value as used without storing it anywhere
+ */
+inline void keep_alive(size_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile ("" : : "r" (value));
+#else
+  static volatile size_t result;
+  result = value;
+  (void) result;
+#endif
+}
+
+void replay(const std::vector<Step> &steps, const Clock &clock,
+            OperationStats *stats)
+{
+  HashMap<std::string, std::string> map;
+  size_t sink = 0;
+  for (const Step &step : steps)
+  {
+    size_t allocs_before = allocations.load (std::memory_order_relaxed);
+    size_t bytes_before = allocated_bytes.load (std::memory_order_relaxed);
+    uint64_t start = clock.now ();
+    switch (step.op)
+    {
+      case INSERT:
+        sink += map.insert (step.key, step.value);
+        break;
+      case AT:
+        try
+        {
+          sink += map.at (step.key).size ();
+        }
+        catch (const std::runtime_error &)
+        {
+        }
+        break;
+      case ERASE:
+        sink += map.erase (step.key);
+        break;
+      case INDEX:
+        map[step.key] = step.value;
+        break;
+      default:
+        break;
+    }
+    uint64_t end = clock.now ();
+    OperationStats &cur = stats[step.op];
+    cur.latency.record (clock.to_ns (end - start));
+    cur.allocations += allocations.load (std::memory_order_relaxed)
+                       - allocs_before;
+    cur.bytes += allocated_bytes.load (std::memory_order_relaxed)
+                 - bytes_before;
+  }
+  // keeps the results alive so the calls are not optimized away
+  keep_alive (sink);
+}
+
+void report(const OperationStats *stats, const Clock &clock)
+{
+  std::cout << "clock: " << clock.name () << ", latencies in ns\n";
+  std::cout << std::left << std::setw (12) << "operation" << std::right
+            << std::setw (10) << "count" << std::setw (10) << "p50"
+            << std::setw (10) << "p99" << std::setw (10) << "p99.9"
+            << std::setw (12) << "max" << std::setw (12) << "allocs/op"
+            << std::setw (12) << "bytes/op" << "\n";
+  for (int op = 0; op < OPERATIONS; op++)
+  {
+    const OperationStats &cur = stats[op];
+    uint64_t count = cur.latency.count ();
+    if (count == 0)
+    {
+      continue;
+    }
+    std::cout << std::left << std::setw (12) << operation_names[op]
+              << std::right << std::setw (10) << count
+              << std::setw (10) << cur.latency.percentile (50)
+              << std::setw (10) << cur.latency.percentile (99)
+              << std::setw (10) << cur.latency.percentile (99.9)
+              << std::setw (12) << cur.latency.max ()
+              << std::setw (12) << std::fixed << std::setprecision (2)
+              << (double) cur.allocations / count
+              << std::setw (12) << (double) cur.bytes / count << "\n";
+  }
+}
+
+int main(int argc, char **argv)
+{
+  size_t operations = DEFAULT_OPERATIONS;
+  bool use_tsc = true;
+  const char *trace = nullptr;
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::strcmp (argv[i], "-n") == 0 && i + 1 < argc)
+    {
+      operations = std::strtoul (argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp (argv[i], "--steady") == 0)
+    {
+      use_tsc = false;
+    }
+    else if (argv[i][0] != '-' && trace == nullptr)
+    {
+      trace = argv[i];
+    }
+    else
+    {
+      std::cerr << USAGE << std::endl;
+      return 1;
+    }
+  }
+  std::vector<Step> steps;
+  if (trace != nullptr)
+  {
+    if (!read_trace (trace, steps))
+    {
+      return 1;
+    }
+  }
+  else
+  {
+    if (operations < 4)
+    {
+      std::cerr << USAGE << std::endl;
+      return 1;
+    }
+    steps = make_workload (operations);
+  }
+  Clock clock (use_tsc);
+  OperationStats stats[OPERATIONS];
+  replay (steps, clock, stats);
+  report (stats, clock);
+  return 0;
+}
@@ -1,8 +1,13 @@
 #include <sstream>
 #include <iostream>
 #include <cmath>
+#include <thread>
 #include "HashMap.hpp"
 #include "Dictionary.hpp"
+#include "CacheMap.hpp"
+#include "CompactDictionary.hpp"
+#include "AggregationMap.hpp"
+#include "SplitHashMap.hpp"
 #define FUNC(name) std::make_pair(#name, name)
 #define IS_TRUE(x) IS_TRUE_MSG(x, "")
 #define IS_TRUE_MSG(x, msg) if (!(x)) { std::cout << __FUNCTION__ << " failed on line " << __LINE__ << ". Message: " << msg << std::endl; return false; }
@@ -82,6 +87,23 @@ bool test_size_and_resize() {
   return true;
 }
 
+bool test_large_table() {
+  HashMap<long long, long long> map;
+  const long long n = 1 << 17;
+  for (long long i = 0; i < n; i ++) {
+    map.insert (i << 32, i);
+  }
+  IS_TRUE_MSG(map.size() == (size_t) n, "Size is: " << map.size())
+  IS_TRUE_MSG(map.capacity() == (size_t) 1 << 18, "Cap is: " << map.capacity())
+  IS_TRUE(map.at (((long long) 777) << 32) == 777)
+  for (long long i = 0; i < n; i ++) {
+    map.erase (i << 32);
+  }
+  IS_TRUE(map.empty())
+  IS_TRUE_MSG(map.capacity() == 1, "Cap is: " << map.capacity())
+  return true;
+}
+
 bool test_basic_insert_erase() {
   HashMap<int, int> map;
   IS_TRUE(map.empty())
@@ -96,6 +118,66 @@ bool test_basic_insert_erase() {
   return true;
 }
 
+bool test_erase_if() {
+  HashMap<int, int> map;
+  for (int i = 0; i < 1000; i ++) {
+    map.insert (i, i);
+  }
+  IS_TRUE(map.capacity() == 2048)
+  IS_TRUE(map.erase_if ([] (const std::pair<int, int> &p) { return p.first % 10 != 0; }) == 900)
+  IS_TRUE(map.size() == 100)
+  IS_TRUE_MSG(map.capacity() == 256, "Got capacity of " << map.capacity())
+  for (int i = 0; i < 1000; i ++) {
+    IS_TRUE(map.contains_key (i) == (i % 10 == 0))
+  }
+  IS_TRUE(map.erase_if ([] (const std::pair<int, int> &) { return true; }) == 100)
+  IS_TRUE(map.empty() && map.capacity() == 1)
+  return true;
+}
+
+bool test_iterator_erase() {
+  HashMap<int, int> map;
+  for (int i = 0; i < 100; i ++) {
+    map.insert (i, i);
+    map.insert (i + 256, i);
+  }
+  size_t cap = map.capacity();
+  int visited = 0;
+  for (auto it = map.begin(), end = map.end(); it != end; ) {
+    visited ++;
+    it = it->first % 2 == 0 ? map.erase (it) : ++it;
+  }
+  IS_TRUE(visited == 200)
+  IS_TRUE(map.size() == 100 && map.capacity() == cap)
+  for (const auto &cur : map) {
+    IS_TRUE(cur.first % 2 == 1)
+  }
+  int erased = 0;
+  for (auto it = map.begin(), end = map.end(); it != end; ) {
+    it = map.erase (it);
+    erased ++;
+  }
+  IS_TRUE(erased == 100)
+  IS_TRUE(map.empty() && map.begin() == map.end() && map.capacity() == cap)
+  map.shrink_to_fit();
+  IS_TRUE_MSG(map.capacity() == 1, map.capacity())
+  for (int i = 0; i < 100000; i ++) {
+    map.insert (i, i);
+  }
+  for (auto it = map.begin(); it != map.end(); ) {
+    it = map.erase (it);
+  }
+  IS_TRUE(map.capacity() == 262144)
+  map.shrink_to_fit();
+  IS_TRUE(map.empty() && map.capacity() == 1)
+  map.insert (7, 7);
+  IS_TRUE(map.at (7) == 7)
+  HashMap<int, int> other;
+  other.insert (1, 1);
+  RAISES_ERROR(std::invalid_argument, map.erase, other.begin())
+  return true;
+}
+
 bool test_clear() {
   HashMap<int, int> map;
   IS_TRUE(map.empty())
@@ -201,12 +283,466 @@ bool test_dict () {
   IS_TRUE(d["Whats"] == "up")
   IS_TRUE(d.erase("Hey"))
   RAISES_ERROR(std::invalid_argument, d.erase, "Hey")
+  d["Gone"] = "soon";
+  IS_TRUE(d.erase_if ([] (const std::pair<std::string, std::string> &p) { return p.second == "soon"; }) == 1)
   IS_TRUE(d.size() == 1)
   d.update (vals.end(), vals.end());
   IS_TRUE(d.size() == 1)
   return true;
 }
 
+bool test_filter () {
+  Dictionary d;
+  d.enable_filter (true);
+  IS_TRUE(d.has_filter())
+  for (int i = 0; i < 5000; i ++) {
+    d["key" + std::to_string (i)] = std::to_string (i);
+  }
+  for (int i = 0; i < 5000; i ++) {
+    IS_TRUE(d.contains_key ("key" + std::to_string (i)))
+  }
+  d.reset_filter_stats();
+  for (int i = 0; i < 100000; i ++) {
+    IS_TRUE(!d.contains_key ("miss" + std::to_string (i)))
+  }
+  FilterStats stats = d.filter_stats();
+  IS_TRUE(stats.lookups == 100000)
+  IS_TRUE(stats.filtered + stats.false_positives == 100000)
+  IS_TRUE_MSG(stats.false_positive_rate() < 0.01, stats.false_positive_rate())
+  IS_TRUE(d.erase ("key7"))
+  IS_TRUE(!d.contains_key ("key7"))
+  Dictionary copy (d);
+  IS_TRUE(copy.has_filter() && copy.contains_key ("key8"))
+  d.clear();
+  IS_TRUE(!d.contains_key ("key8"))
+  d["back"] = "again";
+  IS_TRUE(d.at ("back") == "again")
+  d.disable_filter();
+  IS_TRUE(!d.has_filter() && d.contains_key ("back"))
+  return true;
+}
+
+bool test_filter_churn () {
+  Dictionary d;
+  d.enable_filter (true);
+  const int live = 10000;
+  for (int i = 0; i < live; i ++) {
+    d.insert ("key" + std::to_string (i), "v");
+  }
+  size_t cap = d.capacity();
+  // replace the oldest key with a new one, the size never changes
+  for (int i = live; i < 20 * live; i ++) {
+    d.erase ("key" + std::to_string (i - live));
+    d.insert ("key" + std::to_string (i), "v");
+  }
+  IS_TRUE(d.size() == (size_t) live && d.capacity() == cap)
+  auto it = d.begin();
+  for (int i = 0; i < 5000; i ++) {
+    it = d.erase (it);
+  }
+  d.reset_filter_stats();
+  for (int i = 0; i < 100000; i ++) {
+    IS_TRUE(!d.contains_key ("miss" + std::to_string (i)))
+  }
+  IS_TRUE_MSG(d.filter_stats().false_positive_rate() < 0.01,
+              d.filter_stats().false_positive_rate())
+  return true;
+}
+
+bool test_filter_cap () {
+  HashMap<long, long> map;
+  // 4KB is 128 blocks, room for 4096 keys
+  map.enable_filter (true, 4096);
+  for (long i = 0; i < 4000; i ++) {
+    map.insert (i, i);
+  }
+  IS_TRUE(map.has_filter() && map.filter_active())
+  for (long i = 4000; i < 20000; i ++) {
+    map.insert (i, i);
+  }
+  // saturated, lookups skip the filter instead of paying for it
+  IS_TRUE(map.has_filter() && !map.filter_active())
+  map.reset_filter_stats();
+  IS_TRUE(map.contains_key (19999) && !map.contains_key (20000))
+  IS_TRUE(map.filter_stats().lookups == 0)
+  HashMap<long, long> copy (map);
+  IS_TRUE(copy.has_filter() && !copy.filter_active())
+  for (long i = 2000; i < 20000; i ++) {
+    map.erase (i);
+  }
+  IS_TRUE(map.filter_active())
+  for (long i = 0; i < 100000; i ++) {
+    IS_TRUE(map.contains_key (i) == (i < 2000))
+  }
+  IS_TRUE_MSG(map.filter_stats().false_positive_rate() < 0.05,
+              map.filter_stats().false_positive_rate())
+  map.disable_filter();
+  IS_TRUE(!map.has_filter() && !map.filter_active())
+  return true;
+}
+
+bool test_compact_dict () {
+  CompactDictionary d;
+  s_pair_vec vals;
+  vals.emplace (vals.end(), "Hey", "There");
+  vals.emplace (vals.end(), "Whats", "up");
+  vals.emplace (vals.end(), "Hey", "bye");
+  d.update (vals.begin(), vals.end());
+  IS_TRUE(d.size() == 2)
+  IS_TRUE(d.at ("Hey") == "bye")
+  IS_TRUE(d.at ("Whats") == "up")
+  IS_TRUE(d.erase ("Hey"))
+  RAISES_ERROR(std::invalid_argument, d.erase, "Hey")
+  RAISES_ERROR(std::runtime_error, d.at, "Hey")
+  IS_TRUE(d.size() == 1)
+  std::string long_key (40, 'k');
+  IS_TRUE(d.insert ("", "empty key"))
+  IS_TRUE(d.insert (long_key, std::string (100, 'v')))
+  IS_TRUE(!d.insert (long_key, "other"))
+  IS_TRUE(d.at ("") == "empty key")
+  IS_TRUE(d.at (long_key) == std::string (100, 'v'))
+  for (int i = 0; i < 2000; i ++) {
+    d.set ("a rather long key number " + std::to_string (i), std::to_string (i));
+  }
+  for (int i = 0; i < 2000; i += 2) {
+    d.erase ("a rather long key number " + std::to_string (i));
+  }
+  IS_TRUE(d.size() == 1003)
+  for (int i = 0; i < 2000; i ++) {
+    bool inside = d.contains_key ("a rather long key number " + std::to_string (i));
+    IS_TRUE(inside == (i % 2 == 1))
+    if (inside) {
+      IS_TRUE(d.at ("a rather long key number " + std::to_string (i)) == std::to_string (i))
+    }
+  }
+  size_t count = 0;
+  for (const auto &cur : d) {
+    IS_TRUE(d.at (cur.first) == cur.second)
+    count ++;
+  }
+  IS_TRUE(count == d.size())
+  d.clear();
+  IS_TRUE(d.empty() && d.begin() == d.end())
+  return true;
+}
+
+bool test_compact_dict_interning () {
+  CompactDictionary interned (true);
+  CompactDictionary plain;
+  std::string status = "application/json; charset=utf-8";
+  for (int i = 0; i < 10000; i ++) {
+    std::string key = "request-" + std::to_string (i);
+    interned.insert (key, status);
+    plain.insert (key, status);
+  }
+  IS_TRUE(interned.interned_count() == 1)
+  IS_TRUE(interned.at ("request-77") == status)
+  IS_TRUE_MSG(plain.memory_bytes() - interned.memory_bytes() >= 9999 * status.size(),
+              interned.memory_bytes() << " vs " << plain.memory_bytes())
+  interned.set ("request-77", "short");
+  IS_TRUE(interned.at ("request-77") == "short")
+  return true;
+}
+
+bool test_compact_dict_interning_release () {
+  CompactDictionary d (true);
+  std::string shared = "text/html; charset=iso-8859-1";
+  d.insert ("a", shared);
+  d.insert ("b", shared);
+  d.erase ("a");
+  IS_TRUE(d.interned_count() == 1 && d.at ("b") == shared)
+  // every value is replaced by a new one, the old ones must not pile up
+  for (int i = 0; i < 20000; i ++) {
+    d.set ("session", "token-" + std::to_string (i) + "-0123456789abcdef");
+    IS_TRUE(d.interned_count() == 2)
+  }
+  IS_TRUE(d.at ("session") == "token-19999-0123456789abcdef")
+  IS_TRUE(d.at ("b") == shared)
+  d.erase ("session");
+  d.erase ("b");
+  IS_TRUE(d.interned_count() == 0)
+  IS_TRUE_MSG(d.memory_bytes() < 16 * 1024, d.memory_bytes())
+  return true;
+}
+
+bool test_cache_lru () {
+  CacheMap<int, int> cache (2);
+  int val = 0;
+  IS_TRUE(cache.put (1, 10) && cache.put (2, 20))
+  IS_TRUE(cache.get (1, val) && val == 10)
+  cache.put (3, 30);
+  IS_TRUE(cache.size() == 2)
+  IS_TRUE(!cache.contains_key (2))
+  IS_TRUE(cache.contains_key (1) && cache.contains_key (3))
+  IS_TRUE(!cache.get (2, val))
+  cache.put (1, 11);
+  cache.put (4, 40);
+  IS_TRUE(cache.get (1, val) && val == 11)
+  IS_TRUE(!cache.contains_key (3))
+  IS_TRUE(cache.stats().hits == 2)
+  IS_TRUE(cache.stats().misses == 1)
+  IS_TRUE(cache.stats().evictions == 2)
+  IS_TRUE(cache.erase (1) && !cache.erase (1))
+  IS_TRUE(cache.size() == 1)
+  typedef CacheMap<int, int> int_cache;
+  RAISES_ERROR(std::invalid_argument, int_cache, 0)
+  return true;
+}
+
+bool test_cache_clock () {
+  CacheMap<int, int> cache (3, EvictionPolicy::CLOCK);
+  int val = 0;
+  for (int i = 0; i < 3; i ++) {
+    cache.put (i, i);
+  }
+  IS_TRUE(cache.get (0, val) && cache.get (2, val))
+  cache.put (3, 3);
+  IS_TRUE(!cache.contains_key (1))
+  IS_TRUE(cache.contains_key (0) && cache.contains_key (2))
+  for (int i = 0; i < 100; i ++) {
+    cache.put (i, i);
+    IS_TRUE(cache.size() <= 3)
+  }
+  IS_TRUE(cache.get (99, val) && val == 99)
+  return true;
+}
+
+bool test_cache_s3fifo () {
+  CacheMap<int, int> cache (10, EvictionPolicy::S3FIFO);
+  int val = 0;
+  for (int i = 0; i < 10; i ++) {
+    cache.put (i, i);
+  }
+  // a hot key survives a scan of one-hit wonders
+  IS_TRUE(cache.get (0, val))
+  for (int i = 100; i < 200; i ++) {
+    cache.put (i, i);
+    IS_TRUE(cache.size() <= 10)
+  }
+  IS_TRUE(cache.get (0, val) && val == 0)
+  IS_TRUE(!cache.contains_key (150))
+  IS_TRUE(cache.stats().evictions == 100)
+  return true;
+}
+
+bool test_cache_bytes () {
+  typedef CacheMap<std::string, std::string> str_cache;
+  str_cache cache (10, EvictionPolicy::LRU, CapacityUnit::BYTES,
+                   [] (const std::string &key, const std::string &value)
+                   { return key.size() + value.size(); });
+  IS_TRUE(cache.put ("a", "1234"))
+  IS_TRUE(cache.put ("b", "1234"))
+  IS_TRUE(cache.weight() == 10)
+  IS_TRUE(cache.put ("c", "12"))
+  IS_TRUE(!cache.contains_key ("a") && cache.weight() == 8)
+  IS_TRUE(!cache.put ("d", "1234567890"))
+  IS_TRUE(cache.size() == 2)
+  return true;
+}
+
+bool test_sharded_cache () {
+  ShardedCacheMap<int, int> cache (64, 4);
+  int val = 0;
+  IS_TRUE(cache.shard_count() == 4)
+  for (int i = 0; i < 1000; i ++) {
+    cache.put (i, i);
+  }
+  IS_TRUE(cache.size() <= 64)
+  IS_TRUE(cache.get (999, val) && val == 999)
+  IS_TRUE(cache.stats().evictions == 1000 - cache.size())
+  cache.clear();
+  IS_TRUE(cache.size() == 0)
+  // 100 does not split evenly over 16 shards, none of it may be lost
+  ShardedCacheMap<int, int> uneven (100, 16);
+  IS_TRUE_MSG(uneven.capacity() == 100, uneven.capacity())
+  for (int i = 0; i < 100000; i ++) {
+    uneven.put (i, i);
+  }
+  IS_TRUE_MSG(uneven.size() == 100, uneven.size())
+  return true;
+}
+
+bool test_aggregation () {
+  AggregationMap<std::string, int> counts (8);
+  IS_TRUE(counts.partition_count() == 8)
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 4; t ++) {
+    workers.emplace_back ([&counts] () {
+      AggregationMap<std::string, int>::LocalBuffer local (counts, 16);
+      for (int i = 0; i < 10000; i ++) {
+        local.add ("word" + std::to_string (i % 100), 1);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  counts.add ("word0", 5);
+  IS_TRUE(counts.size() == 100)
+  HashMap<std::string, int> result = counts.merge();
+  IS_TRUE(result.size() == 100)
+  IS_TRUE_MSG(result.at ("word0") == 405, result.at ("word0"))
+  IS_TRUE(result.at ("word99") == 400)
+  counts.merge_into (result);
+  IS_TRUE(result.at ("word1") == 800)
+
+  AggregationMap<int, int, std::function<int (int, int)>> maxes (
+      4, [] (int a, int b) { return a > b ? a : b; });
+  {
+    AggregationMap<int, int, std::function<int (int, int)>>::LocalBuffer local (maxes);
+    local.combine (1, 3);
+    local.combine (1, 7);
+    local.combine (2, 1);
+    IS_TRUE(local.size() == 2 && maxes.size() == 0)
+  }
+  maxes.combine (1, 5);
+  HashMap<int, int> max_result = maxes.merge();
+  IS_TRUE(max_result.at (1) == 7 && max_result.at (2) == 1)
+  maxes.clear();
+  IS_TRUE(maxes.size() == 0)
+  return true;
+}
+
+struct BigValue {
+  int id = 0;
+  char payload[196] = {};
+  bool operator== (const BigValue &other) const { return id == other.id; }
+};
+
+struct CountedKey {
+  int id;
+  static size_t hashes;
+  bool operator== (const CountedKey &other) const { return id == other.id; }
+};
+size_t CountedKey::hashes = 0;
+
+namespace std {
+template <> struct hash<CountedKey> {
+  size_t operator() (const CountedKey &key) const {
+    CountedKey::hashes ++;
+    return std::hash<int> {} (key.id);
+  }
+};
+}
+
+bool test_split_map_hashes_once () {
+  SplitHashMap<CountedKey, int> map;
+  for (int i = 0; i < 1000; i ++) {
+    map.insert (CountedKey {i}, i);
+  }
+  // growing reuses the stored hashes, so every insert hashed once
+  IS_TRUE_MSG(CountedKey::hashes == 1000, CountedKey::hashes)
+  CountedKey::hashes = 0;
+  IS_TRUE(map.erase_if ([] (const auto &cur) { return cur.second % 2 == 0; }) == 500)
+  for (int i = 1; i < 1000; i += 2) {
+    IS_TRUE(map.erase (CountedKey {i}))
+  }
+  // shifting slots back and shrinking do not hash the moved keys
+  IS_TRUE_MSG(CountedKey::hashes == 500, CountedKey::hashes)
+  IS_TRUE(map.empty() && map.capacity() == 16)
+  return true;
+}
+
+bool test_split_map () {
+  SplitHashMap<int, BigValue> map;
+  IS_TRUE(map.empty() && map.capacity() == 16)
+  for (int i = 0; i < 1000; i ++) {
+    BigValue value;
+    value.id = i;
+    IS_TRUE(map.insert (i, value))
+  }
+  IS_TRUE(!map.insert (5, BigValue()))
+  IS_TRUE(map.size() == 1000 && map.capacity() == 2048)
+  IS_TRUE(map.contains_key (999) && !map.contains_key (1000))
+  IS_TRUE(map.at (500).id == 500)
+  map[2000].id = 7;
+  IS_TRUE(map.at (2000).id == 7)
+  RAISES_ERROR(std::exception, map.at, 3000)
+  int count = 0;
+  long sum = 0;
+  for (auto it = map.cbegin(); it != map.cend(); it ++) {
+    IS_TRUE(it->second.id == (it->first == 2000 ? 7 : it->first))
+    sum += (*it).first;
+    count ++;
+  }
+  IS_TRUE(count == 1001 && sum == 999 * 500 + 2000)
+  IS_TRUE(map.erase (2000) && !map.erase (2000))
+  IS_TRUE(map.erase_if ([] (const auto &cur) {
+    return cur.first % 4 != 0;
+  }) == 750)
+  for (int i = 0; i < 1000; i ++) {
+    IS_TRUE(map.contains_key (i) == (i % 4 == 0))
+  }
+  IS_TRUE_MSG(map.capacity() == 512, map.capacity())
+  SplitHashMap<int, BigValue> copy (map);
+  IS_TRUE(copy == map)
+  copy.erase (0);
+  IS_TRUE(copy != map)
+  for (int i = 0; i < 1000; i += 4) {
+    map.erase (i);
+  }
+  IS_TRUE(map.empty() && map.begin() == map.end() && map.capacity() == 16)
+
+  std::vector<std::string> keys {"a", "b", "a"};
+  std::vector<int> vals {1, 2, 3};
+  SplitHashMap<std::string, int> strings (keys, vals);
+  IS_TRUE(strings.size() == 2 && strings["a"] == 3 && strings["b"] == 2)
+  strings.clear();
+  IS_TRUE(strings.empty() && !strings.contains_key ("a"))
+  return true;
+}
+
+bool test_split_map_iterator_erase () {
+  SplitHashMap<int, int> map;
+  for (int i = 0; i < 3000; i ++) {
+    map.insert (i * 7919, i);
+  }
+  // HashMap style code that names the pair type keeps compiling
+  long sum = 0;
+  for (const std::pair<int, int> &cur : map) {
+    sum += cur.second;
+  }
+  IS_TRUE(sum == 2999L * 3000 / 2)
+  IS_TRUE(map.erase_if ([] (const std::pair<int, int> &cur) { return cur.second % 3 == 0; }) == 1000)
+  size_t cap = map.capacity();
+  // items shifted across the end of the array must not be seen twice
+  std::vector<int> seen (3000, 0);
+  int erased = 0;
+  for (auto it = map.begin(), end = map.end(); it != end; ) {
+    seen[it->second] ++;
+    if (it->second % 3 == 1) {
+      it = map.erase (it);
+      erased ++;
+    } else {
+      ++ it;
+    }
+  }
+  IS_TRUE(erased == 1000 && map.size() == 1000 && map.capacity() == cap)
+  for (int i = 0; i < 3000; i ++) {
+    IS_TRUE(seen[i] == (i % 3 == 0 ? 0 : 1))
+    IS_TRUE(map.contains_key (i * 7919) == (i % 3 == 2))
+  }
+  for (auto it = map.begin(); it != map.end(); ) {
+    it = map.erase (it);
+  }
+  IS_TRUE(map.empty() && map.begin() == map.end() && map.capacity() == cap)
+  map.shrink_to_fit();
+  IS_TRUE(map.capacity() == 16)
+  RAISES_ERROR(std::invalid_argument, map.erase, map.end())
+  // all three have their home in the last slot, the run wraps to the front
+  SplitHashMap<size_t, int> wrapped;
+  wrapped.insert (15, 0);
+  wrapped.insert (31, 1);
+  wrapped.insert (47, 2);
+  std::vector<int> visits (3, 0);
+  for (auto it = wrapped.begin(), end = wrapped.end(); it != end; ) {
+    visits[it->second] ++;
+    it = wrapped.erase (it);
+  }
+  IS_TRUE(wrapped.empty() && visits == std::vector<int> (3, 1))
+  return true;
+}
+
 typedef bool (*testFunc) ();
 
 int main () {
@@ -215,12 +751,30 @@ int main () {
       FUNC(test_copy_cntr),
       FUNC(test_special_cntr),
       FUNC(test_size_and_resize),
+      FUNC(test_large_table),
       FUNC(test_bucket_ops),
       FUNC(test_basic_insert_erase),
       FUNC(test_iterator),
+      FUNC(test_erase_if),
+      FUNC(test_iterator_erase),
       FUNC(test_clear),
       FUNC(test_compare),
       FUNC(test_dict),
+      FUNC(test_filter),
+      FUNC(test_filter_churn),
+      FUNC(test_filter_cap),
+      FUNC(test_compact_dict),
+      FUNC(test_compact_dict_interning),
+      FUNC(test_compact_dict_interning_release),
+      FUNC(test_cache_lru),
+      FUNC(test_cache_clock),
+      FUNC(test_cache_s3fifo),
+      FUNC(test_cache_bytes),
+      FUNC(test_sharded_cache),
+      FUNC(test_aggregation),
+      FUNC(test_split_map),
+      FUNC(test_split_map_hashes_once),
+      FUNC(test_split_map_iterator_erase),
   };
   int passed = 0;
   int failed = 0;